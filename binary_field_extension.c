@@ -77,3 +77,67 @@ FieldElement FromUint32(FiniteField f, uint32_t binary) {
     kfree(target);
     return elem;
 }
+
+// carry-less multiplication modulo the field polynomial, only used to build the tables
+static uint8_t clmul_mod(uint8_t lhs, uint8_t rhs, uint16_t modulus, uint8_t deg) {
+    uint16_t res = 0;
+    uint16_t shifted = lhs;
+    while (rhs > 0) {
+        if (rhs & 1) {
+            res ^= shifted;
+        }
+        shifted <<= 1;
+        if (shifted & (1 << deg)) {
+            shifted ^= modulus;
+        }
+        rhs >>= 1;
+    }
+    return res;
+}
+
+struct Uint8Tables *CreateUint8Tables(FiniteField f) {
+    struct Uint8Tables *tables;
+    uint16_t modulus = 0;
+    uint16_t order, g, i;
+    uint8_t deg, value;
+    if (f->p != 2 || PolynomDeg(f->pol) == 0 || PolynomDeg(f->pol) > 8) return NULL;
+    deg = PolynomDeg(f->pol);
+    for (i = 0; i < f->pol->coeff_size; i++) {
+        modulus |= f->pol->coefficients[i] << i;
+    }
+    order = (1 << deg) - 1;
+
+    tables = (struct Uint8Tables *) kmalloc(sizeof(struct Uint8Tables), GFP_KERNEL);
+    if (tables == NULL) return NULL;
+
+    // ищем порождающий элемент мультипликативной группы
+    for (g = 1; g <= order; g++) {
+        value = g;
+        for (i = 1; value != 1 && i <= order; i++) {
+            value = clmul_mod(value, g, modulus, deg);
+        }
+        if (i == order) break;
+    }
+    if (g > order) { // modulus is not irreducible
+        kfree(tables);
+        return NULL;
+    }
+
+    for (i = 0; i < 256; i++) {
+        tables->log[i] = UINT8_LOG_ZERO;
+    }
+    value = 1;
+    for (i = 0; i < order; i++) {
+        tables->exp[i] = value;
+        tables->log[value] = i;
+        value = clmul_mod(value, g, modulus, deg);
+    }
+    for (i = order; i < 2 * UINT8_LOG_ZERO + 1; i++) {
+        tables->exp[i] = i < 2 * order ? tables->exp[i - order] : 0;
+    }
+    return tables;
+}
+
+void FreeUint8Tables(struct Uint8Tables *tables) {
+    kfree(tables);
+}
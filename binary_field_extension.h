@@ -17,4 +17,21 @@ FieldElement FromUint16(FiniteField f, uint16_t binary);
 
 FieldElement FromUint32(FiniteField f, uint32_t binary);
 
+// GF(2^n), n <= 8: elements as bytes, multiplication through log/exp tables
+#define UINT8_LOG_ZERO 511 // log of zero, any sum with it lands in the zero tail of exp
+
+struct Uint8Tables {
+    uint16_t log[256];
+    uint8_t exp[2 * UINT8_LOG_ZERO + 1]; // exp[i] = g^i for i < 510, 0 past that
+};
+
+// returns NULL if f is not a binary field of degree <= 8
+struct Uint8Tables *CreateUint8Tables(FiniteField f);
+
+void FreeUint8Tables(struct Uint8Tables *tables);
+
+static inline uint8_t MultUint8(struct Uint8Tables const *tables, uint8_t lhs, uint8_t rhs) {
+    return tables->exp[tables->log[lhs] + tables->log[rhs]];
+}
+
 #endif //FINITEFIELDSHW_BINARY_FIELD_EXTENSION_H
@@ -0,0 +1,29 @@
+#ifndef DRIVER_CHARDRIVER_H
+#define DRIVER_CHARDRIVER_H
+
+#include <linux/types.h>
+
+/*
+ * In-kernel access to the generator stream, no file or VFS involved.
+ *
+ * gen = chardriver_gen_create();
+ * chardriver_gen_seed(gen, seed, len); // k, a_0, ... , a_k-1, x_0, ... , x_k-1, c - as write(/dev/chardev)
+ * chardriver_gen_fill(gen, buf, len);
+ * chardriver_gen_destroy(gen);
+ *
+ * create, seed and destroy may sleep. fill never sleeps or allocates and is
+ * safe from atomic and softirq context. It holds the handle's lock, with
+ * interrupts off, for at most 256 bytes at a time: concurrent fills on one
+ * handle may interleave between those chunks, each byte still goes to one
+ * caller. seed never waits for a fill in progress, the fill switches to the
+ * new seed at its next chunk.
+ */
+
+struct chardriver_gen;
+
+struct chardriver_gen *chardriver_gen_create(void);
+int chardriver_gen_seed(struct chardriver_gen *gen, const u8 *seed, size_t len);
+int chardriver_gen_fill(struct chardriver_gen *gen, u8 *buf, size_t len);
+void chardriver_gen_destroy(struct chardriver_gen *gen);
+
+#endif //DRIVER_CHARDRIVER_H
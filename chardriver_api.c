@@ -0,0 +1,84 @@
+#include <linux/errno.h>
+#include <linux/export.h>
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+
+#include "chardriver.h"
+#include "generator.h"
+
+/* bytes generated per lock hold in chardriver_gen_fill */
+#define FILL_CHUNK 256
+
+struct chardriver_gen {
+    spinlock_t lock;
+    struct generator gen;
+};
+
+/* fill работает только в блочном режиме: там нет выделений памяти */
+static int setup_block_generator(struct generator *gen)
+{
+    if(setup_generator(gen) < 0) return -ENOMEM;
+    gen->tables = gen->field->tables; // regardless of block_mode
+    if(gen->tables == NULL){
+        free_generator(gen);
+        return -EINVAL;
+    }
+    return 0;
+}
+
+struct chardriver_gen *chardriver_gen_create(void)
+{
+    struct chardriver_gen *handle = kzalloc(sizeof(*handle), GFP_KERNEL);
+    if(handle == NULL) return NULL;
+    if(setup_block_generator(&handle->gen) < 0){
+        kfree(handle);
+        return NULL;
+    }
+    spin_lock_init(&handle->lock);
+    return handle;
+}
+EXPORT_SYMBOL_GPL(chardriver_gen_create);
+
+int chardriver_gen_seed(struct chardriver_gen *handle, const u8 *seed, size_t len)
+{
+    /* новое состояние собирается без блокировки, fill подхватит его сам */
+    struct generator_config *cfg = create_config(&handle->gen, seed, len);
+    if(cfg == NULL) return -EINVAL;
+    if(cfg->step == NULL){
+        put_config(cfg);
+        return -ENOMEM;
+    }
+    publish_config(&handle->gen, cfg);
+    return 0;
+}
+EXPORT_SYMBOL_GPL(chardriver_gen_seed);
+
+int chardriver_gen_fill(struct chardriver_gen *handle, u8 *buf, size_t len)
+{
+    unsigned long flags;
+    int res;
+
+    /* кусками: прерывания запрещены не дольше FILL_CHUNK байт при любом len */
+    do {
+        size_t n = min_t(size_t, len, FILL_CHUNK);
+        spin_lock_irqsave(&handle->lock, flags);
+        /* опубликованные здесь seed всегда блочные: ни sync, ни fill ничего не выделяют */
+        res = sync_generator(&handle->gen);
+        if(res >= 0) res = fill_random(&handle->gen, buf, n);
+        spin_unlock_irqrestore(&handle->lock, flags);
+        if(res < 0) return -EINVAL;
+        buf += n;
+        len -= n;
+    } while(len > 0);
+    return 0;
+}
+EXPORT_SYMBOL_GPL(chardriver_gen_fill);
+
+void chardriver_gen_destroy(struct chardriver_gen *handle)
+{
+    if(handle == NULL) return;
+    free_generator(&handle->gen);
+    kfree(handle);
+}
+EXPORT_SYMBOL_GPL(chardriver_gen_destroy);
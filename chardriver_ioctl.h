@@ -0,0 +1,96 @@
+#ifndef DRIVER_CHARDRIVER_IOCTL_H
+#define DRIVER_CHARDRIVER_IOCTL_H
+
+/* shared by the driver and userspace, no kernel-only types */
+#include <linux/ioctl.h>
+#include <linux/types.h>
+
+#define CHARDRIVER_IOC_MAGIC 'g'
+
+/*
+ * Page mapped read-only by mmap(fd, PAGE_SIZE, PROT_READ, MAP_SHARED, 0).
+ * Describes the last reserved segment: x[pos..k-1], then the recurrence
+ * x_n = a_0 x_n-k + ... + a_k-1 x_n-1 + c over GF(2)[x]/modulus started from x.
+ * seq is odd while the kernel rewrites the page.
+ */
+struct chardriver_page {
+    __u32 seq;
+    __u16 modulus;   // field polynomial, bit i is the coefficient of x^i
+    __u8 k;
+    __u8 c;
+    __u8 pos;
+    __u8 reserved[7];
+    __u64 offset;    // position of the segment in the stream
+    __u64 len;       // outputs in the segment
+    __u8 a[255];
+    __u8 x[255];
+};
+
+struct chardriver_reserve {
+    __u64 offset;    // out: as in the page
+    __u64 len;       // out: as in the page
+    __u32 seq;       // out: page seq that describes this segment
+    __u32 pad;
+};
+
+/* skips the generator past the next segment and publishes it in the page */
+#define CHARDRIVER_IOC_RESERVE _IOR(CHARDRIVER_IOC_MAGIC, 1, struct chardriver_reserve)
+
+/*
+ * Generator contexts: independent streams behind one fd, addressed by id.
+ * CTX_CREATE returns a new id (ids start at 1), CTX_SEED takes the same
+ * seed as write(), CTX_FILL fills up to CHARDRIVER_MAX_BATCH buffers from
+ * any contexts in one call.
+ */
+#define CHARDRIVER_MAX_BATCH 1024
+
+struct chardriver_ctx_seed {
+    __u32 id;
+    __u32 len;
+    __u64 seed;      // user pointer: k, a_0, ... , a_k-1, x_0, ... , x_k-1, c
+};
+
+struct chardriver_fill {
+    __u32 id;
+    __u32 pad;
+    __u64 buf;       // user pointer
+    __u64 len;
+    __s64 result;    // out: bytes written or -errno
+};
+
+struct chardriver_batch {
+    __u64 fills;     // user pointer to count struct chardriver_fill
+    __u32 count;
+    __u32 done;      // out: entries processed, less than count after a signal
+};
+
+#define CHARDRIVER_IOC_CTX_CREATE _IOR(CHARDRIVER_IOC_MAGIC, 2, __u32)
+#define CHARDRIVER_IOC_CTX_SEED _IOW(CHARDRIVER_IOC_MAGIC, 3, struct chardriver_ctx_seed)
+#define CHARDRIVER_IOC_CTX_DESTROY _IOW(CHARDRIVER_IOC_MAGIC, 4, __u32)
+#define CHARDRIVER_IOC_CTX_FILL _IOWR(CHARDRIVER_IOC_MAGIC, 5, struct chardriver_batch)
+
+/*
+ * Checkpoint of a generator: x[pos..k-1] are its next outputs, then the
+ * recurrence continues from x, as in struct chardriver_page. CHARDRIVER_IOC_SAVE
+ * fills it for id, RESTORE makes generator id continue from it.
+ */
+#define CHARDRIVER_STATE_VERSION 1
+
+struct chardriver_state {
+    __u32 version;   // CHARDRIVER_STATE_VERSION
+    __u32 id;        // 0 - the fd's own generator, otherwise a context
+    __u16 modulus;   // must match the field on restore
+    __u8 k;
+    __u8 c;
+    __u8 pos;
+    __u8 reserved[3];
+    __u64 offset;    // outputs handed out since the last write, 0 for contexts
+    __u8 a[255];
+    __u8 x[255];
+    __u8 pad[2];
+};
+
+#define CHARDRIVER_IOC_SAVE _IOWR(CHARDRIVER_IOC_MAGIC, 6, struct chardriver_state)
+#define CHARDRIVER_IOC_RESTORE _IOW(CHARDRIVER_IOC_MAGIC, 7, struct chardriver_state)
+
+#endif //DRIVER_CHARDRIVER_IOCTL_H
@@ -7,12 +7,20 @@
 #include <linux/kernel.h>
 #include <linux/module.h>
 #include <linux/printk.h>
+#include <linux/sched.h>
+#include <linux/sched/signal.h>
 #include <linux/types.h>
 #include <linux/uaccess.h>
 #include <linux/version.h>
 #include <linux/kdev_t.h>
+#include <linux/mm.h>
+#include <linux/mutex.h>
+#include <linux/rwsem.h>
+#include <linux/slab.h>
+#include <linux/xarray.h>
 #include <asm/errno.h>
 
+#include "chardriver_ioctl.h"
 #include "generator.h"
 #include "finite_fields.h"
 
@@ -23,6 +31,13 @@
  * write(/dev/chardev, k, a_0, ... , a_k-1, x_0, ... x_k-1, c) - инициализировали начальные значения, теперь можно использовать
  * read(/dev/chardev)
  * ...
+ * mmap(chardev, PAGE_SIZE, PROT_READ) + ioctl(CHARDRIVER_IOC_RESERVE) - отрезки потока
+ * для генерации в пространстве пользователя, см. lib/libchardriver.h
+ * ...
+ * ioctl(CHARDRIVER_IOC_CTX_CREATE / CTX_SEED) - дополнительные независимые потоки на том же fd,
+ * ioctl(CHARDRIVER_IOC_CTX_FILL) - несколько буферов из нескольких потоков за один вызов
+ * ioctl(CHARDRIVER_IOC_SAVE / RESTORE) - снимок позиции потока и продолжение с него
+ * ...
  * fclose(/dev/chardev)
  * ...
  * rmmod chardriver
@@ -33,6 +48,30 @@ static int device_open(struct inode *, struct file *);
 static int device_release(struct inode *, struct file *);
 static ssize_t device_read(struct file *, char __user *, size_t, loff_t *);
 static ssize_t device_write(struct file *, const char __user *, size_t, loff_t *);
+static long device_ioctl(struct file *, unsigned int, unsigned long);
+static int device_mmap(struct file *, struct vm_area_struct *);
+
+static unsigned int segment_size = 65536;
+module_param(segment_size, uint, 0444);
+MODULE_PARM_DESC(segment_size, "minimal number of outputs handed out by CHARDRIVER_IOC_RESERVE");
+
+static unsigned int max_contexts = 65536;
+module_param(max_contexts, uint, 0444);
+MODULE_PARM_DESC(max_contexts, "generator contexts one open file may hold");
+
+struct chardev_ctx {
+    struct generator *gen;   // from the generator pool
+    struct mutex lock;
+};
+
+struct chardev_file {
+    struct generator *gen;         // from the generator pool
+    struct mutex lock;             // generation, reseeding and reservations
+    struct chardriver_page *page;  // published by mmap, NULL until then
+    u64 stream_pos;                // outputs handed out since the last write
+    struct xarray contexts;        // id -> struct chardev_ctx
+    struct rw_semaphore ctx_lock;  // held for write only to free a context
+};
 
 #define SUCCESS 0
 #define DEVICE_NAME "chardev"
@@ -51,6 +90,9 @@ static struct file_operations chardev_fops = {
 	.write = device_write,
 	.open = device_open,
 	.release = device_release,
+	.unlocked_ioctl = device_ioctl,
+	.compat_ioctl = compat_ptr_ioctl,
+	.mmap = device_mmap,
 };
 
 static struct cdev my_cdev;
@@ -58,6 +100,7 @@ static dev_t dev_num;
 
 static int __init register_module(void)
 {
+    fill_generator_pool(); // short of memory the pool is just smaller
     if(alloc_chrdev_region(&dev_num, 0, 1, DEVICE_NAME) < 0)
         goto fail;
 
@@ -83,6 +126,7 @@ static int __init register_module(void)
 unregister:
     unregister_chrdev_region(dev_num, 1);
 fail:
+    drain_generator_pool();
     pr_alert("Registering char device failed");
     return -1;
 }
@@ -94,66 +138,446 @@ static void __exit unregister_module(void)
     class_destroy(cls);
     cdev_del(&my_cdev);
 	unregister_chrdev_region(dev_num, 1);
+    drain_generator_pool();
+    rcu_barrier(); // old generator configs are freed from RCU callbacks
     pr_info("removed module\n");
 }
 
 
 static int device_open(struct inode *inode, struct file *file)
 {
-    struct generator *gen;
+    struct chardev_file *cf;
     if (atomic_cmpxchg(&already_open, CDEV_NOT_USED, CDEV_EXCLUSIVE_OPEN))
         return -EBUSY;
 
-    gen = (struct generator*) kzalloc(sizeof(struct generator), GFP_KERNEL);
+    cf = (struct chardev_file *) kzalloc(sizeof(struct chardev_file), GFP_KERNEL);
+    if(cf != NULL) cf->gen = take_generator();
 
-    if(gen == NULL || setup_generator(gen) < 0) {
+    if(cf == NULL || cf->gen == NULL) {
+        kfree(cf);
+        atomic_set(&already_open, CDEV_NOT_USED);
         return -ENOMEM;
     }
+    mutex_init(&cf->lock);
+    xa_init_flags(&cf->contexts, XA_FLAGS_ALLOC1);
+    init_rwsem(&cf->ctx_lock);
 
-    file->private_data = gen;
+    file->private_data = cf;
 
     return SUCCESS;
 }
 
 
+static void free_ctx(struct chardev_ctx *ctx)
+{
+    put_generator(ctx->gen);
+    mutex_destroy(&ctx->lock);
+    kfree(ctx);
+}
+
 static int device_release(struct inode *inode, struct file *file)
 {
-    struct generator *gen = (struct generator *) file->private_data;
-    free_generator(gen);
+    struct chardev_file *cf = (struct chardev_file *) file->private_data;
+    struct chardev_ctx *ctx;
+    unsigned long id;
+
+    xa_for_each(&cf->contexts, id, ctx){
+        free_ctx(ctx);
+    }
+    xa_destroy(&cf->contexts);
+    put_generator(cf->gen);
+    free_page((unsigned long) cf->page);
+    mutex_destroy(&cf->lock);
+    kfree(cf);
 	atomic_set(&already_open, CDEV_NOT_USED);
 	return SUCCESS;
 }
 
 
+/* перед каждой порцией - проверка сигналов, между порциями - точка вытеснения */
+#define READ_CHUNK 256
+
+/*
+ * Fills a user buffer from gen, lock is held per chunk only. Returns the
+ * bytes written, or an error if none were.
+ */
+static ssize_t fill_user(struct generator *gen, struct mutex *lock, char __user *buffer,
+                         size_t length, u64 *stream_pos)
+{
+    ssize_t bytes_read = 0;
+    ssize_t err = 0;
+    uint8_t chunk[READ_CHUNK];
+
+    while(bytes_read < length){
+        /* пишем в пользовательский буфер порциями */
+        size_t n = min_t(size_t, length - bytes_read, sizeof(chunk));
+        /* до генерации, чтобы прерванный read не тратил поток впустую */
+        if(signal_pending(current)){
+            err = -ERESTARTSYS;
+            break;
+        }
+        if(mutex_lock_interruptible(lock)){
+            err = -ERESTARTSYS;
+            break;
+        }
+        /* новый seed подхватывается здесь, write() читателей не ждёт */
+        if(sync_generator(gen) > 0 && stream_pos != NULL) *stream_pos = 0;
+        if(fill_random(gen, chunk, n) < 0){
+            mutex_unlock(lock);
+            err = -EIO;
+            break;
+        }
+        if(stream_pos != NULL) *stream_pos += n;
+        mutex_unlock(lock);
+        if(copy_to_user(buffer + bytes_read, chunk, n)){
+            err = -EFAULT;
+            break;
+        }
+        bytes_read += n;
+        if(bytes_read < length) cond_resched();
+    }
+
+    /* уже отданные байты не теряем */
+    return bytes_read == 0 ? err : bytes_read;
+}
+
 static ssize_t device_read(struct file *file, /* include linux/fs.h */
 			   char __user *buffer, /* buffer to fill with data*/
 			   size_t length, /* length of the buffer */
 			   loff_t *offset)
 {
-    int bytes_read;
-    struct generator *gen = (struct generator *) file->private_data;;
-	bytes_read = 0;
-    for(size_t n = 0; n < length; n++){
-        /* пишем в пользовательский буфер */
-        uint8_t target;
-        if(get_random(gen, &target) < 0){
-            return -1;
-        }
-        put_user(target, buffer++);
-        bytes_read++;
-    }
+    struct chardev_file *cf = (struct chardev_file *) file->private_data;
+    ssize_t bytes_read;
 
+    if(length == 0) return 0;
+    bytes_read = fill_user(cf->gen, &cf->lock, buffer, length, &cf->stream_pos);
+    if(bytes_read > 0) *offset += bytes_read;
 	return bytes_read;
 }
 
 static ssize_t device_write(struct file *file, const char __user *buff,
 			    size_t len, loff_t *off)
 {
-	struct generator *gen = (struct generator *) file->private_data;
-    if(gen == NULL || init_random(gen, buff, len) < 0){
-        return -1;
+	struct chardev_file *cf = (struct chardev_file *) file->private_data;
+    /* только публикация, stream_pos обнулит читатель, подхвативший seed */
+    int res;
+    if(len > GENERATOR_SEED_MAX) return -EINVAL;
+    res = init_random(cf->gen, buff, len);
+    return res < 0 ? -1 : len;
+}
+
+static u16 modulus_bits(FiniteField f)
+{
+    u16 res = 0;
+    for(size_t i = 0; i < f->pol->coeff_size; i++){
+        res |= f->pol->coefficients[i] << i;
+    }
+    return res;
+}
+
+/* страница переписывается под seq, как vdso_data */
+static long device_reserve(struct chardev_file *cf, struct chardriver_reserve __user *arg)
+{
+    struct chardriver_page *page;
+    struct chardriver_reserve res;
+    struct generator *gen = cf->gen;
+    ssize_t len = -EINVAL;
+    u32 seq;
+
+    mutex_lock(&cf->lock);
+    page = cf->page;
+    if(sync_generator(gen) > 0) cf->stream_pos = 0;
+    if(page == NULL || gen->k == 0) goto out;
+
+    seq = page->seq;
+    WRITE_ONCE(page->seq, seq + 1);
+    smp_wmb();
+
+    len = reserve_random(gen, DIV_ROUND_UP(segment_size, gen->k), page->x, &page->pos);
+    if(len < 0){
+        len = -EOPNOTSUPP;
+        smp_wmb();
+        WRITE_ONCE(page->seq, seq + 2); // the previous segment stays valid
+        goto out;
+    }
+    page->modulus = modulus_bits(gen->field);
+    page->k = gen->k;
+    page->c = gen->c;
+    memcpy(page->a, gen->a, gen->k);
+    page->offset = cf->stream_pos;
+    page->len = len;
+
+    smp_wmb();
+    WRITE_ONCE(page->seq, seq + 2);
+
+    res.offset = cf->stream_pos;
+    res.len = len;
+    res.seq = seq + 2;
+    res.pad = 0;
+    cf->stream_pos += len;
+out:
+    mutex_unlock(&cf->lock);
+    if(len < 0) return len;
+    return copy_to_user(arg, &res, sizeof(res)) ? -EFAULT : 0;
+}
+
+/* id 0 is the file's own generator; ctx_lock is held for read on success */
+static int lookup_gen(struct chardev_file *cf, u32 id, struct generator **gen, struct mutex **lock, u64 **stream_pos)
+{
+    struct chardev_ctx *ctx;
+
+    down_read(&cf->ctx_lock);
+    if(id == 0){
+        *gen = cf->gen;
+        *lock = &cf->lock;
+        *stream_pos = &cf->stream_pos;
+        return 0;
+    }
+    ctx = xa_load(&cf->contexts, id);
+    if(ctx == NULL){
+        up_read(&cf->ctx_lock);
+        return -ENOENT;
+    }
+    *gen = ctx->gen;
+    *lock = &ctx->lock;
+    *stream_pos = NULL;
+    return 0;
+}
+
+static long device_save(struct chardev_file *cf, struct chardriver_state __user *arg)
+{
+    struct chardriver_state *st;
+    struct generator *gen;
+    struct mutex *lock;
+    u64 *stream_pos;
+    uint8_t *seed;
+    long res;
+    u32 id;
+
+    if(get_user(id, &arg->id)) return -EFAULT;
+    st = (struct chardriver_state *) kzalloc(sizeof(*st), GFP_KERNEL);
+    seed = (uint8_t *) kmalloc(GENERATOR_SEED_MAX, GFP_KERNEL);
+    if(st == NULL || seed == NULL){
+        res = -ENOMEM;
+        goto out;
+    }
+    res = lookup_gen(cf, id, &gen, &lock, &stream_pos);
+    if(res < 0) goto out;
+
+    mutex_lock(lock);
+    if(sync_generator(gen) > 0 && stream_pos != NULL) *stream_pos = 0;
+    res = save_random(gen, seed, &st->pos) < 0 ? -EINVAL : 0;
+    if(stream_pos != NULL) st->offset = *stream_pos;
+    st->modulus = modulus_bits(gen->field); // gen may be freed once ctx_lock is dropped
+    mutex_unlock(lock);
+    up_read(&cf->ctx_lock);
+    if(res < 0) goto out;
+
+    st->version = CHARDRIVER_STATE_VERSION;
+    st->id = id;
+    st->k = seed[0];
+    memcpy(st->a, seed + 1, st->k);
+    memcpy(st->x, seed + 1 + st->k, st->k);
+    st->c = seed[2 * st->k + 1];
+    res = copy_to_user(arg, st, sizeof(*st)) ? -EFAULT : 0;
+out:
+    kfree(seed);
+    kfree(st);
+    return res;
+}
+
+static long device_restore(struct chardev_file *cf, struct chardriver_state __user *arg)
+{
+    struct chardriver_state *st;
+    struct generator *gen;
+    struct mutex *lock;
+    u64 *stream_pos;
+    uint8_t *seed = NULL;
+    long res;
+
+    st = (struct chardriver_state *) memdup_user(arg, sizeof(*st));
+    if(IS_ERR(st)) return PTR_ERR(st);
+    res = -EINVAL;
+    if(st->version != CHARDRIVER_STATE_VERSION || st->k == 0 || st->pos > st->k) goto out;
+    seed = (uint8_t *) kmalloc(GENERATOR_SEED_MAX, GFP_KERNEL);
+    if(seed == NULL){
+        res = -ENOMEM;
+        goto out;
+    }
+    seed[0] = st->k;
+    memcpy(seed + 1, st->a, st->k);
+    memcpy(seed + 1 + st->k, st->x, st->k);
+    seed[2 * st->k + 1] = st->c;
+
+    res = lookup_gen(cf, st->id, &gen, &lock, &stream_pos);
+    if(res < 0) goto out;
+    if(st->modulus != modulus_bits(gen->field)){
+        up_read(&cf->ctx_lock);
+        res = -EINVAL;
+        goto out;
+    }
+    mutex_lock(lock);
+    res = restore_random(gen, seed, 2 * st->k + 2, st->pos) < 0 ? -EINVAL : 0;
+    if(res == 0 && stream_pos != NULL) *stream_pos = st->offset;
+    mutex_unlock(lock);
+    up_read(&cf->ctx_lock);
+out:
+    kfree(seed);
+    kfree(st);
+    return res;
+}
+
+static long ctx_create(struct chardev_file *cf, __u32 __user *arg)
+{
+    struct chardev_ctx *ctx;
+    u32 id;
+    int err;
+
+    ctx = (struct chardev_ctx *) kzalloc(sizeof(struct chardev_ctx), GFP_KERNEL_ACCOUNT);
+    if(ctx == NULL) return -ENOMEM;
+    ctx->gen = take_generator();
+    if(ctx->gen == NULL){
+        kfree(ctx);
+        return -ENOMEM;
+    }
+    mutex_init(&ctx->lock);
+
+    err = xa_alloc(&cf->contexts, &id, ctx, XA_LIMIT(1, max_contexts), GFP_KERNEL_ACCOUNT);
+    if(err < 0){
+        free_ctx(ctx);
+        return err == -EBUSY ? -ENOSPC : err;
+    }
+    if(put_user(id, arg)){
+        /* id последовательные, другой поток мог угадать его и уже работать с ctx */
+        down_write(&cf->ctx_lock);
+        xa_erase(&cf->contexts, id);
+        up_write(&cf->ctx_lock);
+        free_ctx(ctx);
+        return -EFAULT;
+    }
+    return 0;
+}
+
+static long ctx_destroy(struct chardev_file *cf, __u32 __user *arg)
+{
+    struct chardev_ctx *ctx;
+    u32 id;
+
+    if(get_user(id, arg)) return -EFAULT;
+    /* ждём, пока контекст не используется ни одним CTX_FILL / CTX_SEED */
+    down_write(&cf->ctx_lock);
+    ctx = xa_erase(&cf->contexts, id);
+    up_write(&cf->ctx_lock);
+    if(ctx == NULL) return -ENOENT;
+    free_ctx(ctx);
+    return 0;
+}
+
+static long ctx_seed(struct chardev_file *cf, struct chardriver_ctx_seed __user *arg)
+{
+    struct chardriver_ctx_seed req;
+    struct chardev_ctx *ctx;
+    long res = -ENOENT;
+
+    if(copy_from_user(&req, arg, sizeof(req))) return -EFAULT;
+    down_read(&cf->ctx_lock);
+    ctx = xa_load(&cf->contexts, req.id);
+    if(ctx != NULL){
+        res = init_random(ctx->gen, u64_to_user_ptr(req.seed), req.len) < 0 ? -EINVAL : 0;
+    }
+    up_read(&cf->ctx_lock);
+    return res;
+}
+
+/* every entry gets its own result, a signal stops the batch between entries */
+static long ctx_fill(struct chardev_file *cf, struct chardriver_batch __user *arg)
+{
+    struct chardriver_batch batch;
+    struct chardriver_fill __user *user_fills;
+    struct chardriver_fill *fills;
+    long err = 0;
+    u32 done;
+
+    if(copy_from_user(&batch, arg, sizeof(batch))) return -EFAULT;
+    if(batch.count == 0 || batch.count > CHARDRIVER_MAX_BATCH) return -EINVAL;
+    user_fills = u64_to_user_ptr(batch.fills);
+    fills = vmemdup_user(user_fills, batch.count * sizeof(*fills));
+    if(IS_ERR(fills)) return PTR_ERR(fills);
+
+    down_read(&cf->ctx_lock);
+    for(done = 0; done < batch.count; done++){
+        struct chardriver_fill *fill = &fills[done];
+        struct chardev_ctx *ctx;
+
+        if(done > 0 && signal_pending(current)) break;
+        ctx = xa_load(&cf->contexts, fill->id);
+        if(ctx == NULL){
+            fill->result = -ENOENT;
+        } else if(fill->len == 0){
+            fill->result = 0;
+        } else {
+            fill->result = fill_user(ctx->gen, &ctx->lock, u64_to_user_ptr(fill->buf),
+                                     min_t(u64, fill->len, MAX_RW_COUNT), NULL);
+        }
+        /* прерванная до первого байта запись не считается выполненной */
+        if(fill->result == -ERESTARTSYS) break;
+        if(put_user(fill->result, &user_fills[done].result)){
+            err = -EFAULT;
+            break;
+        }
+    }
+    up_read(&cf->ctx_lock);
+    kvfree(fills);
+
+    if(err < 0) return err;
+    if(done == 0) return -ERESTARTSYS;
+    return put_user(done, &arg->done) ? -EFAULT : 0;
+}
+
+static long device_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
+{
+    struct chardev_file *cf = (struct chardev_file *) file->private_data;
+    switch(cmd){
+        case CHARDRIVER_IOC_RESERVE:
+            return device_reserve(cf, (struct chardriver_reserve __user *) arg);
+        case CHARDRIVER_IOC_CTX_CREATE:
+            return ctx_create(cf, (__u32 __user *) arg);
+        case CHARDRIVER_IOC_CTX_SEED:
+            return ctx_seed(cf, (struct chardriver_ctx_seed __user *) arg);
+        case CHARDRIVER_IOC_CTX_DESTROY:
+            return ctx_destroy(cf, (__u32 __user *) arg);
+        case CHARDRIVER_IOC_CTX_FILL:
+            return ctx_fill(cf, (struct chardriver_batch __user *) arg);
+        case CHARDRIVER_IOC_SAVE:
+            return device_save(cf, (struct chardriver_state __user *) arg);
+        case CHARDRIVER_IOC_RESTORE:
+            return device_restore(cf, (struct chardriver_state __user *) arg);
+        default:
+            return -ENOTTY;
     }
-    return len;
+}
+
+/* одна страница только для чтения */
+static int device_mmap(struct file *file, struct vm_area_struct *vma)
+{
+    struct chardev_file *cf = (struct chardev_file *) file->private_data;
+
+    if(vma->vm_pgoff != 0 || vma->vm_end - vma->vm_start != PAGE_SIZE) return -EINVAL;
+    if(vma->vm_flags & VM_WRITE) return -EPERM;
+
+    mutex_lock(&cf->lock);
+    if(cf->page == NULL){
+        cf->page = (struct chardriver_page *) get_zeroed_page(GFP_KERNEL);
+    }
+    mutex_unlock(&cf->lock);
+    if(cf->page == NULL) return -ENOMEM;
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 3, 0)
+    vm_flags_clear(vma, VM_MAYWRITE);
+#else
+    vma->vm_flags &= ~VM_MAYWRITE;
+#endif
+    return vm_insert_page(vma, vma->vm_start, virt_to_page(cf->page));
 }
 
 module_init(register_module);
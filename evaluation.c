@@ -0,0 +1,211 @@
+#include "evaluation.h"
+#include "binary_field_extension.h"
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+
+// GF(2^m): f(x) is the sum of x^i over the nonzero coefficients, i * log x walks the exp table
+static uint8_t table_value(Polynom f, struct Uint8Tables const *tables, uint16_t order, uint8_t x) {
+    uint16_t step, ind = 0;
+    uint8_t res = 0;
+    if (x == 0) return f->coefficients[0];
+    step = tables->log[x];
+    for (uint8_t i = 0; i < f->coeff_size; i++) {
+        res ^= tables->exp[ind] & -f->coefficients[i];
+        ind += step;
+        if (ind >= order) ind -= order;
+    }
+    return res;
+}
+
+int EvaluatePolynomUint8(Polynom f, FiniteField field, uint8_t const *points, uint8_t *values, size_t n) {
+    struct Uint8Tables const *tables = field->tables;
+    uint16_t order;
+    uint8_t all[256];
+
+    if (tables == NULL || f->p != field->p) return -1;
+    order = field->order;
+    for (size_t i = 0; i < n; i++) {
+        if (points[i] > order) return -1;
+    }
+    if (n <= order) {
+        for (size_t i = 0; i < n; i++) values[i] = table_value(f, tables, order, points[i]);
+        return 0;
+    }
+    // more points than field elements: evaluate everywhere once
+    for (uint16_t x = 0; x <= order; x++) all[x] = table_value(f, tables, order, x);
+    for (size_t i = 0; i < n; i++) values[i] = all[points[i]];
+    return 0;
+}
+
+// elements as m coefficients over F_p, little-endian
+struct horner {
+    uint8_t p;
+    uint8_t m;
+    uint8_t lead_inv;    // inverse of the modulus' leading coefficient
+    uint8_t const *pol;  // modulus, m + 1 coefficients
+    uint8_t *matrix;     // m x m, column j is x * t^j mod pol
+    uint8_t *acc;
+    uint8_t *next;
+};
+
+static uint8_t inverse_mod(uint8_t a, uint8_t p) {
+    for (uint16_t c = 1; c < p; c++) {
+        if (c * a % p == 1) return c;
+    }
+    return 0;
+}
+
+static bool setup_horner(struct horner *h, FiniteField field) {
+    h->p = field->p;
+    h->m = PolynomDeg(field->pol);
+    h->pol = field->pol->coefficients;
+    h->lead_inv = inverse_mod(h->pol[h->m], h->p);
+    h->matrix = (uint8_t *) kmalloc(h->m * h->m + 2 * h->m, GFP_KERNEL);
+    if (h->matrix == NULL) return false;
+    h->acc = h->matrix + h->m * h->m;
+    h->next = h->acc + h->m;
+    return true;
+}
+
+// multiplication by x as a matrix, so a Horner step is one pass without reductions
+static void build_matrix(struct horner *h, uint8_t const *x) {
+    uint8_t m = h->m, p = h->p;
+    for (uint8_t i = 0; i < m; i++) h->matrix[i * m] = x[i];
+    for (uint8_t j = 1; j < m; j++) {
+        // t * column, t^m = -lead^(-1) * (pol_0 + ... + pol_m-1 * t^(m-1))
+        uint8_t top = h->matrix[(m - 1) * m + j - 1] * h->lead_inv % p;
+        for (uint8_t i = 0; i < m; i++) {
+            uint8_t shifted = i == 0 ? 0 : h->matrix[(i - 1) * m + j - 1];
+            h->matrix[i * m + j] = (shifted + (p - top) * h->pol[i]) % p;
+        }
+    }
+}
+
+static void horner_value(struct horner *h, Polynom f, uint8_t *out) {
+    uint8_t m = h->m;
+    memset(h->acc, 0, m);
+    h->acc[0] = f->coefficients[f->coeff_size - 1];
+    for (int k = f->coeff_size - 2; k >= 0; k--) {
+        uint8_t *dummy;
+        for (uint8_t i = 0; i < m; i++) {
+            uint32_t sum = 0; // (p-1)^2 * 254 still fits
+            for (uint8_t j = 0; j < m; j++) {
+                sum += (uint32_t) h->matrix[i * m + j] * h->acc[j];
+            }
+            h->next[i] = sum % h->p;
+        }
+        h->next[0] = (h->next[0] + f->coefficients[k]) % h->p;
+        dummy = h->acc;
+        h->acc = h->next;
+        h->next = dummy;
+    }
+    memcpy(out, h->acc, m);
+}
+
+static void load(FieldElement elem, uint8_t *out, uint8_t m) {
+    memset(out, 0, m);
+    memcpy(out, elem->pol->coefficients, elem->pol->coeff_size);
+}
+
+// raw: n values, m coefficients each
+static int evaluate_raw(Polynom f, FieldElement const *points, size_t n, FiniteField field, uint8_t *raw) {
+    struct horner h;
+    uint8_t *table = NULL;
+    uint8_t m;
+
+    if (!setup_horner(&h, field)) return -1;
+    m = h.m;
+    if (field->order == 0 || field->order >= n) {
+        for (size_t i = 0; i < n; i++) {
+            load(points[i], raw + i * m, m);
+            build_matrix(&h, raw + i * m);
+            horner_value(&h, f, raw + i * m);
+        }
+        kfree(h.matrix);
+        return 0;
+    }
+
+    // more points than field elements: evaluate everywhere once, element v has base-p digits v
+    table = (uint8_t *) kmalloc_array(field->order + 1, m, GFP_KERNEL);
+    if (table == NULL) {
+        kfree(h.matrix);
+        return -1;
+    }
+    for (uint64_t v = 0; v <= field->order; v++) {
+        uint8_t *x = table + v * m;
+        uint64_t digits = v;
+        for (uint8_t i = 0; i < m; i++, digits /= h.p) x[i] = digits % h.p;
+        build_matrix(&h, x);
+        horner_value(&h, f, x);
+    }
+    for (size_t i = 0; i < n; i++) {
+        Polynom pol = points[i]->pol;
+        uint64_t v = 0;
+        for (int j = pol->coeff_size - 1; j >= 0; j--) v = v * h.p + pol->coefficients[j];
+        memcpy(raw + i * m, table + v * m, m);
+    }
+    kfree(table);
+    kfree(h.matrix);
+    return 0;
+}
+
+static FieldElement *to_elements(FiniteField field, uint8_t const *raw, size_t n) {
+    uint8_t m = PolynomDeg(field->pol);
+    FieldElement *values;
+    int *coeffs;
+
+    values = (FieldElement *) kcalloc(n, sizeof(FieldElement), GFP_KERNEL);
+    coeffs = (int *) kmalloc_array(m, sizeof(int), GFP_KERNEL);
+    if (values == NULL || coeffs == NULL) goto fail;
+    for (size_t i = 0; i < n; i++) {
+        if (field->tables != NULL) {
+            values[i] = FromUint8(field, raw[i]);
+        } else {
+            for (uint8_t j = 0; j < m; j++) coeffs[m - 1 - j] = raw[i * m + j]; // big-endian
+            values[i] = GetFromArray(field, coeffs, m);
+        }
+        if (values[i] == NULL) goto fail;
+    }
+    kfree(coeffs);
+    return values;
+
+fail:
+    kfree(coeffs);
+    FreeValues(values, n);
+    return NULL;
+}
+
+FieldElement *EvaluatePolynom(Polynom f, FieldElement const *points, size_t n) {
+    FiniteField field;
+    FieldElement *values;
+    uint8_t *raw;
+    int res;
+
+    if (n == 0) return NULL;
+    field = points[0]->field;
+    if (f->p != field->p) return NULL;
+    for (size_t i = 1; i < n; i++) {
+        if (!AreEqualFields(points[i]->field, field)) return NULL;
+    }
+
+    if (field->tables != NULL) {
+        raw = (uint8_t *) kmalloc(n, GFP_KERNEL);
+        if (raw == NULL) return NULL;
+        for (size_t i = 0; i < n; i++) raw[i] = ToUint8(points[i]);
+        res = EvaluatePolynomUint8(f, field, raw, raw, n);
+    } else {
+        raw = (uint8_t *) kmalloc_array(n, PolynomDeg(field->pol), GFP_KERNEL);
+        if (raw == NULL) return NULL;
+        res = evaluate_raw(f, points, n, field, raw);
+    }
+    values = res < 0 ? NULL : to_elements(field, raw, n);
+    kfree(raw);
+    return values;
+}
+
+void FreeValues(FieldElement *values, size_t n) {
+    if (values == NULL) return;
+    for (size_t i = 0; i < n; i++) FreeElement(values[i]);
+    kfree(values);
+}
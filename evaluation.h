@@ -0,0 +1,18 @@
+#ifndef FINITEFIELDSHW_EVALUATION_H
+#define FINITEFIELDSHW_EVALUATION_H
+
+#include <linux/types.h>
+#include "finite_field.h"
+#include "field_element.h"
+#include "polynom.h"
+
+// values[i] = f(points[i]), f has coefficients in F_p of the points' field
+// all points must be in one field; returns NULL on error, free with FreeValues
+FieldElement *EvaluatePolynom(Polynom f, FieldElement const *points, size_t n);
+
+// GF(2^m), m <= 8 with elements as bytes; returns -1 if f does not fit the field
+int EvaluatePolynomUint8(Polynom f, FiniteField field, uint8_t const *points, uint8_t *values, size_t n);
+
+void FreeValues(FieldElement *values, size_t n);
+
+#endif //FINITEFIELDSHW_EVALUATION_H
@@ -1,4 +1,6 @@
 #include "field_element.h"
+#include "binary_field_extension.h"
+#include <linux/kernel.h>
 #include <linux/slab.h>
 #include <linux/string.h>
 
@@ -8,17 +10,22 @@ static FieldElement init(FiniteField f) {
     FieldElement element = (FieldElement) kmalloc(sizeof(struct FieldElement), GFP_KERNEL);
     //GFP_KERNEL - выделение производится от имени процесса запущенного в пространстве ядра
     if (element != NULL) {
-        element->field = f;
+        element->field = f; // borrowed, no atomics on the shared kref per temporary
     }
     return element;
 }
 
+// frees an element whose polynom was not allocated
+static void drop(FieldElement elem) {
+    kfree(elem);
+}
+
 static bool descend(FieldElement elem) {
     Polynom dummy = elem->pol;
     elem->pol = ModPolynom(elem->pol, elem->field->pol);
     FreePolynom(dummy);
     if (elem->pol == NULL) {
-        kfree(elem);
+        drop(elem);
         return false;
     }
     return true;
@@ -29,7 +36,7 @@ FieldElement GetIdentity(FiniteField f) {
     if (element == NULL) return NULL;
     element->pol = IdentityPolynom(f->p);
     if (element->pol == NULL) {
-        kfree(element);
+        drop(element);
         return NULL;
     }
     return element;
@@ -48,7 +55,7 @@ FieldElement GetZero(FiniteField f) {
     if (element == NULL) return NULL;
     element->pol = ZeroPolynom(f->p);
     if (element->pol == NULL) {
-        kfree(element);
+        drop(element);
         return NULL;
     }
 
@@ -62,7 +69,7 @@ FieldElement GetFromArray(FiniteField f, int const *array, uint8_t array_size) {
     if (element == NULL) return NULL;
     element->pol = PolynomFromArray(array, array_size, f->p);
     if (element->pol == NULL) {
-        kfree(element);
+        drop(element);
         return NULL;
     }
     if (!descend(element)) {
@@ -80,6 +87,10 @@ FieldElement Copy(FieldElement elem) {
     FieldElement res = init(elem->field);
     if (res != NULL) {
         res->pol = CopyPolynom(elem->pol);
+        if (res->pol == NULL) {
+            drop(res);
+            return NULL;
+        }
     }
     return res;
 }
@@ -102,7 +113,7 @@ FieldElement Add(FieldElement lhs, FieldElement rhs) {
     if (res == NULL) return NULL;
     res->pol = AddPolynom(lhs->pol, rhs->pol);
     if (res->pol == NULL) {
-        kfree(res);
+        drop(res);
         return NULL;
     }
     return res;
@@ -117,7 +128,7 @@ FieldElement Mult(FieldElement lhs, FieldElement rhs) {
     if (res == NULL) return NULL;
     res->pol = MultPolynom(lhs->pol, rhs->pol);
     if (res->pol == NULL) {
-        kfree(res);
+        drop(res);
         return NULL;
     }
     if (!descend(res)) {
@@ -126,70 +137,304 @@ FieldElement Mult(FieldElement lhs, FieldElement rhs) {
     return res;
 }
 
-static int int_fast_pow(int val, int pow) {
-    int result;
-    if (val == 0) return 0;
-    if (val == 1) return 1;
-    result = 1;
-    while (pow > 0) {
-        if (pow % 2 == 1) {
-            result *= val;
+// reduction is linear, so the unreduced products are summed first
+FieldElement DotProduct(FieldElement const *lhs, FieldElement const *rhs, uint8_t n) {
+    FieldElement res;
+    Polynom *pols;
+    if (n == 0) return NULL;
+    for (size_t i = 0; i < n; i++) {
+        if (!InSameField(lhs[i], lhs[0]) || !InSameField(rhs[i], lhs[0])) {
+            return NULL;
         }
-        val *= val;
-        pow /= 2;
     }
-    return result;
-}
+    pols = (Polynom *) kmalloc_array(2 * n, sizeof(Polynom), GFP_KERNEL);
+    if (pols == NULL) return NULL;
+    for (size_t i = 0; i < n; i++) {
+        pols[i] = lhs[i]->pol;
+        pols[n + i] = rhs[i]->pol;
+    }
 
-//p > 0
-static FieldElement element_fast_pow(FieldElement elem, unsigned int p) {
-    FieldElement res, dummy, value;
-    if (IsZeroPolynom(elem->pol)) {
-        return GetZero(elem->field);
+    res = init(lhs[0]->field);
+    if (res == NULL) {
+        kfree(pols);
+        return NULL;
     }
-    if (IsIdentityPolynom(elem->pol)) {
-        return GetIdentity(elem->field);
+    res->pol = DotPolynom(pols, pols + n, n);
+    kfree(pols);
+    if (res->pol == NULL) {
+        drop(res);
+        return NULL;
+    }
+    if (!descend(res)) {
+        return NULL;
+    }
+    return res;
+}
+
+// a -> a^p is F_p-linear: the field's Frobenius matrix applied to the coefficients,
+// scratch is n bytes from the caller, allocated once per exponentiation
+static FieldElement frobenius(FieldElement elem, uint8_t *scratch) {
+    FiniteField f = elem->field;
+    uint8_t n = PolynomDeg(f->pol);
+    FieldElement res;
+
+    if (f->frobenius == NULL) return Copy(elem); // F_p: a^p = a
+    for (uint8_t i = 0; i < n; i++) {
+        uint32_t acc = 0;
+        for (uint8_t j = 0; j < elem->pol->coeff_size; j++) {
+            acc += (uint32_t) f->frobenius[i * n + j] * elem->pol->coefficients[j];
+        }
+        scratch[i] = acc % f->p;
     }
-    res = GetIdentity(elem->field);
-    value = Copy(elem);
-    if (res == NULL || value == NULL) {
-        FreeElement(res);
-        FreeElement(value);
+    res = init(f);
+    if (res == NULL) return NULL;
+    res->pol = PolynomFromCoefficients(scratch, n, f->p);
+    if (res->pol == NULL) {
+        drop(res);
         return NULL;
     }
-    while (p > 0) {
-        if (p % 2 == 1) {
+    return res;
+}
+
+static FieldElement square(FieldElement elem, uint8_t *scratch) {
+    return elem->field->p == 2 ? frobenius(elem, scratch) : Mult(elem, elem);
+}
+
+// scratch for frobenius(), stays NULL when the field needs none
+static bool alloc_scratch(FiniteField f, uint8_t **scratch) {
+    *scratch = NULL;
+    if (f->frobenius == NULL) return true;
+    *scratch = (uint8_t *) kmalloc(PolynomDeg(f->pol), GFP_KERNEL);
+    return *scratch != NULL;
+}
+
+// res * value, consumes res
+static FieldElement mult_into(FieldElement res, FieldElement value) {
+    FieldElement dummy = res;
+    res = Mult(res, value);
+    FreeElement(dummy);
+    return res;
+}
+
+// GF(2^n), n <= 8: a^e = g^(log a * e)
+static FieldElement table_pow(FieldElement elem, uint64_t e) {
+    struct Uint8Tables const *tables = elem->field->tables;
+    uint64_t order = elem->field->order;
+    uint8_t a = ToUint8(elem);
+    if (a == 0) return FromUint8(elem->field, e == 0 ? 1 : 0);
+    return FromUint8(elem->field, tables->exp[tables->log[a] * (e % order) % order]);
+}
+
+#define POW_WINDOW 4
+#define POW_ODD (1 << (POW_WINDOW - 1))
+#define FIXED_BASE_DIGITS ((1 << POW_WINDOW) - 1) // nonzero digits of a window
+
+// sliding window over the bits of e, squarings go through frobenius() in characteristic 2
+static FieldElement window_pow(FieldElement elem, uint64_t e, uint8_t *scratch) {
+    FieldElement odd[POW_ODD] = {NULL}; // odd[i] = a^(2i + 1)
+    FieldElement res = NULL, sq;
+    int i;
+
+    if (e == 0) return GetIdentity(elem->field);
+    odd[0] = Copy(elem);
+    sq = square(elem, scratch);
+    if (odd[0] == NULL || sq == NULL) goto out;
+    for (i = 1; i < POW_ODD; i++) {
+        odd[i] = Mult(odd[i - 1], sq);
+        if (odd[i] == NULL) goto out;
+    }
+
+    i = 63 - __builtin_clzll(e);
+    while (i >= 0) {
+        int low = i - POW_WINDOW + 1;
+        uint64_t digit;
+        if (!(e >> i & 1)) {
             FieldElement dummy = res;
-            res = Mult(res, value);
+            res = square(res, scratch);
             FreeElement(dummy);
-            if (res == NULL) return NULL;
+            if (res == NULL) goto out;
+            i--;
+            continue;
         }
-        dummy = value;
-        value = Mult(value, value);
+        if (low < 0) low = 0;
+        while (!(e >> low & 1)) low++;
+        digit = (e >> low) & ((1u << (i - low + 1)) - 1);
+        if (res == NULL) {
+            res = Copy(odd[digit >> 1]);
+        } else {
+            for (int j = low; j <= i && res != NULL; j++) {
+                FieldElement dummy = res;
+                res = square(res, scratch);
+                FreeElement(dummy);
+            }
+            if (res != NULL) res = mult_into(res, odd[digit >> 1]);
+        }
+        if (res == NULL) goto out;
+        i = low - 1;
+    }
+out:
+    for (i = 0; i < POW_ODD; i++) FreeElement(odd[i]);
+    FreeElement(sq);
+    return res;
+}
+
+// small odd p: Horner in base p, a^(ep + d) = (a^e)^p * a^d with a free p-th power
+static FieldElement frobenius_pow(FieldElement elem, uint64_t e, uint8_t *scratch) {
+    uint8_t p = elem->field->p;
+    uint8_t digits[64];
+    FieldElement powers[POW_ODD * 2] = {NULL}; // powers[d] = a^d, d < p
+    FieldElement res = NULL;
+    int n = 0;
+
+    while (e > 0) {
+        digits[n++] = e % p;
+        e /= p;
+    }
+    powers[0] = GetIdentity(elem->field);
+    if (powers[0] == NULL) goto out;
+    for (uint8_t d = 1; d < p; d++) {
+        powers[d] = Mult(powers[d - 1], elem);
+        if (powers[d] == NULL) goto out;
+    }
+    res = Copy(powers[digits[--n]]);
+    while (n > 0 && res != NULL) {
+        FieldElement dummy = res;
+        res = frobenius(res, scratch);
         FreeElement(dummy);
-        if (value == NULL) return NULL;
-        p /= 2;
+        if (res != NULL && digits[--n] != 0) res = mult_into(res, powers[digits[n]]);
     }
-    FreeElement(value);
+out:
+    for (uint8_t d = 0; d < p && d < POW_ODD * 2; d++) FreeElement(powers[d]);
     return res;
 }
 
+static FieldElement power(FieldElement elem, uint64_t e) {
+    FiniteField f = elem->field;
+    FieldElement res;
+    uint8_t *scratch;
+
+    if (IsZero(elem)) {
+        return e == 0 ? GetIdentity(f) : GetZero(f);
+    }
+    if (f->tables != NULL) return table_pow(elem, e);
+    if (f->order != 0) e %= f->order; // a^(q-1) = 1
+    if (e == 0) return GetIdentity(f);
+    if (!alloc_scratch(f, &scratch)) return NULL;
+    if (f->p != 2 && f->frobenius != NULL && f->p <= POW_ODD * 2) {
+        res = frobenius_pow(elem, e, scratch);
+    } else {
+        res = window_pow(elem, e, scratch);
+    }
+    kfree(scratch);
+    return res;
+}
+
+// NULL if q - 1 does not fit into 64 bits
 FieldElement Inv(FieldElement element) {
-    uint64_t pn;
-    if (IsZero(element)) return NULL;
-    pn = element->field->pol == NULL ? element->field->p - 1 : int_fast_pow(element->field->p,
-                                                                                     PolynomDeg(element->field->pol));
-    return element_fast_pow(element, pn - 2);
+    if (IsZero(element) || element->field->order == 0) return NULL;
+    return power(element, element->field->order - 1);
 }
 
 FieldElement Pow(FieldElement elem, int p) {
     if (p < 0) {
         FieldElement tmp = Inv(elem);
-        FieldElement res = element_fast_pow(tmp, -p);
+        FieldElement res;
+        if (tmp == NULL) return NULL;
+        res = power(tmp, -(int64_t) p);
         FreeElement(tmp);
         return res;
     }
-    return element_fast_pow(elem, p);
+    return power(elem, p);
+}
+
+// exponents are reduced mod q - 1, a negative deg becomes q - 1 - |deg| and may need all 64 bits
+static uint8_t exponent_bits(FiniteField f) {
+    if (f->order == 0) return 31; // only non-negative ints then
+    return 64 - __builtin_clzll(f->order);
+}
+
+struct FixedBase *CreateFixedBase(FieldElement base) {
+    struct FixedBase *fb;
+    uint8_t *scratch = NULL;
+    uint8_t digits = DIV_ROUND_UP(exponent_bits(base->field), POW_WINDOW);
+
+    fb = (struct FixedBase *) kzalloc(sizeof(struct FixedBase), GFP_KERNEL);
+    if (fb == NULL) return NULL;
+    fb->field = HoldField(base->field);
+    fb->base = Copy(base);
+    if (fb->base == NULL || base->field->tables != NULL || IsZero(base)) {
+        // nothing to precompute for the table path
+        if (fb->base == NULL) {
+            FreeFixedBase(fb);
+            return NULL;
+        }
+        return fb;
+    }
+    fb->powers = (FieldElement *) kcalloc(digits * FIXED_BASE_DIGITS, sizeof(FieldElement), GFP_KERNEL);
+    if (fb->powers == NULL || !alloc_scratch(base->field, &scratch)) goto fail;
+    fb->digits = digits;
+    for (uint8_t i = 0; i < digits; i++) {
+        FieldElement *row = fb->powers + i * FIXED_BASE_DIGITS;
+        if (i == 0) {
+            row[0] = Copy(base);
+        } else {
+            // base^(16^i) = (base^(16^(i-1)))^16
+            row[0] = Copy(row[-FIXED_BASE_DIGITS]);
+            for (int j = 0; j < POW_WINDOW && row[0] != NULL; j++) {
+                FieldElement dummy = row[0];
+                row[0] = square(row[0], scratch);
+                FreeElement(dummy);
+            }
+        }
+        if (row[0] == NULL) goto fail;
+        for (uint8_t d = 1; d < FIXED_BASE_DIGITS; d++) {
+            row[d] = Mult(row[d - 1], row[0]);
+            if (row[d] == NULL) goto fail;
+        }
+    }
+    kfree(scratch);
+    return fb;
+
+fail:
+    kfree(scratch);
+    FreeFixedBase(fb);
+    return NULL;
+}
+
+FieldElement FixedBasePow(struct FixedBase const *fb, int deg) {
+    FiniteField f = fb->base->field;
+    FieldElement res = NULL;
+    uint64_t e;
+
+    if (fb->powers == NULL) return Pow(fb->base, deg);
+    if (deg < 0) {
+        // a^(-d) = a^(q-1-d)
+        if (f->order == 0) return NULL;
+        e = f->order - (uint64_t) -(int64_t) deg % f->order;
+    } else {
+        e = deg;
+    }
+    if (f->order != 0) e %= f->order;
+    for (uint8_t i = 0; i < fb->digits && e > 0; i++, e >>= POW_WINDOW) {
+        uint8_t d = e & FIXED_BASE_DIGITS;
+        FieldElement power;
+        if (d == 0) continue;
+        power = fb->powers[i * FIXED_BASE_DIGITS + d - 1];
+        res = res == NULL ? Copy(power) : mult_into(res, power);
+        if (res == NULL) return NULL;
+    }
+    return res == NULL ? GetIdentity(f) : res;
+}
+
+void FreeFixedBase(struct FixedBase *fb) {
+    if (fb == NULL) return;
+    if (fb->powers != NULL) {
+        for (size_t i = 0; i < (size_t) fb->digits * FIXED_BASE_DIGITS; i++) FreeElement(fb->powers[i]);
+    }
+    kfree(fb->powers);
+    FreeElement(fb->base);
+    if (fb->field != NULL) FreeField(fb->field);
+    kfree(fb);
 }
 
 FieldElement Division(FieldElement lhs, FieldElement rhs) {
@@ -207,6 +452,10 @@ FieldElement Neg(FieldElement elem) {
     FieldElement res = init(elem->field);
     if (res == NULL) return NULL;
     res->pol = NegPolynom(elem->pol);
+    if (res->pol == NULL) {
+        drop(res);
+        return NULL;
+    }
     return res;
 }
 
@@ -5,6 +5,7 @@
 #include "finite_field.h"
 #include "polynom.h"
 
+// an element borrows its field: the caller keeps the field held while its elements live
 struct FieldElement {
     Polynom pol;// little - endian
     FiniteField field;
@@ -17,10 +18,28 @@ FieldElement Sub(FieldElement lhs, FieldElement rhs);
 
 FieldElement Mult(FieldElement lhs, FieldElement rhs);
 
+// lhs[0] * rhs[0] + ... + lhs[n-1] * rhs[n-1] with a single reduction
+FieldElement DotProduct(FieldElement const *lhs, FieldElement const *rhs, uint8_t n);
+
+// sliding window, p-th powers are linear maps through the field's Frobenius matrix
 FieldElement Pow(FieldElement elem, int deg);
 
 FieldElement Inv(FieldElement elem); // a^(-1) = a^(p^n-2)
 
+// precomputed base^(d * 16^i) for repeated Pow of the same element
+struct FixedBase {
+    FiniteField field; // held, base and powers borrow it
+    FieldElement base;
+    FieldElement *powers; // base^(d * 16^i) at [i * 15 + d - 1], NULL when no table is needed
+    uint8_t digits;
+};
+
+struct FixedBase *CreateFixedBase(FieldElement base);
+
+FieldElement FixedBasePow(struct FixedBase const *fb, int deg);
+
+void FreeFixedBase(struct FixedBase *fb);
+
 FieldElement Neg(FieldElement elem);
 
 FieldElement Division(FieldElement lhs, FieldElement rhs);
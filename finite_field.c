@@ -1,46 +1,133 @@
 #include "finite_field.h"
+#include "binary_field_extension.h"
+#include <linux/kernel.h>
+#include <linux/mutex.h>
 
-FiniteField CreateF_p(uint8_t p) {
-    FiniteField field = (FiniteField) kmalloc(sizeof(struct FiniteField), GFP_KERNEL);
-    if (field == NULL) return NULL;
-    field->p = p;
-    int irreducible[] = {1, 0};
-    field->pol = PolynomFromArray(irreducible, 2, p);
-    if (field->pol == NULL) {
-        kfree(field);
-        return NULL;
+/* все поля модуля, по одному дескриптору на (p, pol) */
+static LIST_HEAD(registry);
+static DEFINE_MUTEX(registry_lock);
+
+static uint64_t group_order(uint8_t p, uint8_t n) {
+    uint64_t q = 1;
+    for (uint8_t i = 0; i < n; i++) {
+        if (q > U64_MAX / p) return 0;
+        q *= p;
+    }
+    return q - 1;
+}
+
+// a -> a^p is linear over F_p, so it is a matrix acting on the coefficients
+static uint8_t *build_frobenius(uint8_t p, Polynom pol) {
+    uint8_t n = PolynomDeg(pol);
+    uint8_t *matrix;
+    int *x_p;
+    Polynom column, step, tmp;
+
+    if (n < 2) return NULL;
+    matrix = (uint8_t *) kcalloc(n * n, sizeof(uint8_t), GFP_KERNEL);
+    x_p = (int *) kcalloc(p + 1, sizeof(int), GFP_KERNEL);
+    if (matrix == NULL || x_p == NULL) goto fail;
+
+    x_p[0] = 1; // x^p, big-endian
+    tmp = PolynomFromArray(x_p, p + 1, p);
+    if (tmp == NULL) goto fail;
+    step = ModPolynom(tmp, pol);
+    FreePolynom(tmp);
+    column = IdentityPolynom(p);
+    if (step == NULL || column == NULL) {
+        FreePolynom(step);
+        FreePolynom(column);
+        goto fail;
+    }
+
+    for (uint8_t j = 0; j < n; j++) {
+        for (uint8_t i = 0; i < column->coeff_size; i++) {
+            matrix[i * n + j] = column->coefficients[i];
+        }
+        tmp = MultPolynom(column, step);
+        FreePolynom(column);
+        column = tmp == NULL ? NULL : ModPolynom(tmp, pol);
+        FreePolynom(tmp);
+        if (column == NULL) {
+            FreePolynom(step);
+            goto fail;
+        }
+    }
+    FreePolynom(column);
+    FreePolynom(step);
+    kfree(x_p);
+    return matrix;
+
+fail:
+    kfree(x_p);
+    kfree(matrix);
+    return NULL;
+}
+
+// takes ownership of pol
+static FiniteField intern(uint8_t p, Polynom pol) {
+    FiniteField field;
+    if (pol == NULL) return NULL;
+
+    mutex_lock(&registry_lock);
+    list_for_each_entry(field, &registry, node) {
+        if (field->p == p && AreEqualPolynom(field->pol, pol)) {
+            kref_get(&field->ref);
+            mutex_unlock(&registry_lock);
+            FreePolynom(pol);
+            return field;
+        }
     }
+
+    field = (FiniteField) kmalloc(sizeof(struct FiniteField), GFP_KERNEL);
+    if (field != NULL) {
+        field->p = p;
+        field->pol = pol;
+        field->tables = CreateUint8Tables(field);
+        field->frobenius = build_frobenius(p, pol);
+        field->order = group_order(p, PolynomDeg(pol));
+        kref_init(&field->ref);
+        list_add(&field->node, &registry);
+    } else {
+        FreePolynom(pol);
+    }
+    mutex_unlock(&registry_lock);
     return field;
 }
 
+FiniteField CreateF_p(uint8_t p) {
+    int irreducible[] = {1, 0};
+    return intern(p, PolynomFromArray(irreducible, 2, p));
+}
+
 //given polynom is big-endian, stored as little-endia
 
 FiniteField CreateF_q(uint8_t p, uint8_t deg_polynom, int const *polynom) {
-    FiniteField field = (FiniteField) kmalloc(sizeof(struct FiniteField), GFP_KERNEL);
-    if (field == NULL) return NULL;
-    field->pol = PolynomFromArray(polynom, deg_polynom + 1, p);
-    if (field->pol == NULL) {
-        kfree(field);
-        return NULL;
-    }
-    field->p = p;
-    return field;
+    return intern(p, PolynomFromArray(polynom, deg_polynom + 1, p));
+}
+
+FiniteField HoldField(FiniteField f) {
+    kref_get(&f->ref);
+    return f;
 }
 
 bool AreEqualFields(FiniteField lhs, FiniteField rhs) {
-    if (lhs == rhs) {
-        return true;
-    }
-    if (lhs->p != rhs->p) {
-        return false;
-    }
-    if (lhs->pol == NULL || rhs->pol == NULL) return lhs->pol == rhs->pol && lhs->p == rhs->p;
-    return AreEqualPolynom(lhs->pol, rhs->pol);
+    return lhs == rhs;
+}
+
+// called with registry_lock held
+static void release_field(struct kref *ref) {
+    FiniteField f = container_of(ref, struct FiniteField, ref);
+    list_del(&f->node);
+    mutex_unlock(&registry_lock);
+    FreeUint8Tables(f->tables);
+    kfree(f->frobenius);
+    FreePolynom(f->pol);
+    kfree(f);
 }
 
 void FreeField(FiniteField f) {
     if (f != NULL) {
-        FreePolynom(f->pol);
-        kfree(f);
+        kref_put_mutex(&f->ref, release_field, &registry_lock);
     }
 }
@@ -3,11 +3,21 @@
 
 #include <linux/types.h>
 #include <linux/slab.h>
+#include <linux/kref.h>
+#include <linux/list.h>
 #include "polynom.h"
 
+struct Uint8Tables;
+
+// fields are interned: equal (p, pol) always give the same descriptor
 struct FiniteField {
     uint8_t p;
     Polynom pol; //irreducible, mult and division operations are performed modulo polynom
+    struct Uint8Tables *tables; // GF(2^n), n <= 8 only, NULL otherwise
+    uint8_t *frobenius; // n x n over F_p, column j is x^(jp) mod pol; NULL when n = 1
+    uint64_t order;     // p^n - 1, 0 if it does not fit
+    struct kref ref;
+    struct list_head node;
 };
 typedef struct FiniteField *FiniteField;
 
@@ -16,6 +26,9 @@ FiniteField CreateF_p(uint8_t p);
 // deg_polynom - polynom deg, stored deg_polynom+1
 FiniteField CreateF_q(uint8_t p, uint8_t deg_polynom, int const *polynom);
 
+// takes one more reference, released by FreeField
+FiniteField HoldField(FiniteField f);
+
 bool AreEqualFields(FiniteField lhs, FiniteField rhs);
 
 void FreeField(FiniteField f);
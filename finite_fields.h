@@ -3,4 +3,7 @@
 #include "finite_field.h"
 #include "field_element.h"
 #include "binary_field_extension.h"
+#include "evaluation.h"
+#include "matrix.h"
+#include "tower.h"
 #endif //FINITEFIELDSHW_FINITE_FIELDS_H
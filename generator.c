@@ -1,15 +1,50 @@
 #include "generator.h"
+#include <linux/err.h>
 #include <linux/fs.h>
+#include <linux/kernel.h>
+#include <linux/mm.h>
+#include <linux/module.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/string.h>
+
+static bool block_mode = true;
+module_param(block_mode, bool, 0444);
+MODULE_PARM_DESC(block_mode, "generate k outputs per matrix-vector product instead of one per recurrence step");
+
+static unsigned int pool_size = 64;
+module_param(pool_size, uint, 0444);
+MODULE_PARM_DESC(pool_size, "ready generators kept for open() and CHARDRIVER_IOC_CTX_CREATE");
+
+#define MAX_K U8_MAX
+
+static const int irreducible[] = {1,1,1,1,1,1,0,0,1}; // x^8 + x^7 + x^6 + x^5 + x^4 + x^3 + 1
+
+/* takes over the reference to field */
+static int setup_with_field(struct generator *gen, FiniteField field)
+{
+    memset(gen, 0, sizeof(*gen));
+    gen->field = field;
+    /* буферы под наибольшее k, чтобы переход на новый seed ничего не выделял */
+    gen->window = (uint8_t *) kmalloc(MAX_K, GFP_KERNEL);
+    gen->logs = (uint16_t *) kmalloc_array(MAX_K + 1, sizeof(uint16_t), GFP_KERNEL);
+    if(gen->window == NULL || gen->logs == NULL){
+        kfree(gen->window);
+        kfree(gen->logs);
+        FreeField(gen->field);
+        return -1;
+    }
+    /* таблицы общие для всех генераторов над этим полем, без них только пошаговый режим */
+    gen->tables = block_mode ? gen->field->tables : NULL;
+    return 0;
+}
 
 int setup_generator(struct generator *gen)
 {
-    gen->k = 0;
-    gen->a_i = NULL;
-    gen->x_i = NULL;
-    gen->c = NULL;
-    int irreducible[] = {1,1,1,1,1,1,0,0,1}; // x^8 + x^7 + x^6 + x^5 + x^4 + x^3 + 1
-    gen->field = CreateF_q(2, 8, irreducible);
-    return -(gen->field == NULL);
+    FiniteField field = CreateF_q(2, 8, irreducible);
+    if(field == NULL) return -1;
+    return setup_with_field(gen, field);
 }
 
 static void free_elem_buff_if_necessary(FieldElement *buff, size_t size)
@@ -22,73 +57,226 @@ static void free_elem_buff_if_necessary(FieldElement *buff, size_t size)
     }
 }
 
-void free_generator(struct generator *gen)
+static void free_scalar(struct generator *gen)
 {
     free_elem_buff_if_necessary(gen->a_i, gen->k);
     free_elem_buff_if_necessary(gen->x_i, gen->k);
-    FreeElement(gen->c);
-    FreeField(gen->field);
+    FreeElement(gen->c_elem);
+    gen->a_i = NULL;
+    gen->x_i = NULL;
+    gen->c_elem = NULL;
 }
 
-#define __swap(T, x, y) \
-    {                 \
-        T obj = (x);  \
-        (x) = (y);    \
-        (y) = obj;    \
-    }
+static void free_config_rcu(struct rcu_head *head)
+{
+    struct generator_config *cfg = container_of(head, struct generator_config, rcu);
+    kvfree(cfg->step);
+    kfree(cfg);
+}
 
-int get_random(struct generator *gen, uint8_t *target)
+static void release_config(struct kref *ref)
 {
-    FieldElement x_n = GetZero(gen->field);
+    struct generator_config *cfg = container_of(ref, struct generator_config, ref);
+    /* читатели могли получить указатель до подмены */
+    call_rcu(&cfg->rcu, free_config_rcu);
+}
+
+void put_config(struct generator_config *cfg)
+{
+    kref_put(&cfg->ref, release_config);
+}
+
+void free_generator(struct generator *gen)
+{
+    struct generator_config *cfg = rcu_dereference_protected(gen->config, true);
+    if(cfg != NULL) put_config(cfg);
+    if(gen->cur != NULL) put_config(gen->cur);
+    free_scalar(gen);
+    kfree(gen->window);
+    kfree(gen->logs);
+    kvfree(gen->jump);
+    FreeField(gen->field);
+}
+
+static int scalar_step(struct generator *gen, uint8_t *target)
+{
+    uint8_t k = gen->k;
+    FieldElement sum = DotProduct(gen->a_i, gen->x_i, k);
+    if(sum == NULL) return -1;
+
+    FieldElement x_n = Add(sum, gen->c_elem);
+    FreeElement(sum);
     if(x_n == NULL) return -1;
-    FieldElement *tmp_x_i = (FieldElement *) kzalloc(sizeof(FieldElement)*gen->k, GFP_KERNEL);
-    if(tmp_x_i == NULL){
-        FreeElement(x_n);
+
+    /* сдвигаем буфер на один элемент назад */
+    FreeElement(gen->x_i[0]);
+    memmove(gen->x_i, gen->x_i + 1, sizeof(FieldElement) * (k - 1));
+    gen->x_i[k - 1] = x_n;
+    *target = ToUint8(x_n);
+
+    return 0;
+}
+
+/*
+ * Row n of the recurrence expresses x_n through (x_0, ..., x_k-1, 1):
+ * x_n = a_0 x_n-k + ... + a_k-1 x_n-1 + c, so rows k..2k-1 are the k-step
+ * transition matrix and the next window is one matrix-vector product.
+ */
+static int setup_block(struct generator_config *cfg, struct Uint8Tables const *tables)
+{
+    uint8_t k = cfg->k;
+    size_t width = k + 1;
+    uint8_t const *a = cfg->data;
+    uint8_t *rows, *row;
+
+    rows = (uint8_t *) kvcalloc(2 * k * width, sizeof(uint8_t), GFP_KERNEL);
+    cfg->step = (uint16_t *) kvmalloc_array(k * width, sizeof(uint16_t), GFP_KERNEL);
+    if(rows == NULL || cfg->step == NULL){
+        kvfree(rows);
+        kvfree(cfg->step);
+        cfg->step = NULL;
         return -1;
     }
-    uint8_t k = gen->k;
 
     for(size_t i = 0; i < k; i++){
-        FieldElement summand = Mult(gen->a_i[i], gen->x_i[i]);
-
-        if(summand == NULL){
-            free_elem_buff_if_necessary(tmp_x_i, gen->k);
-            FreeElement(x_n);
-            return -1;
+        rows[i * width + i] = 1;
+    }
+    for(size_t n = k; n < 2 * k; n++){
+        row = rows + n * width;
+        for(size_t i = 0; i < k; i++){
+            uint8_t const *prev = rows + (n - k + i) * width;
+            for(size_t j = 0; j < width; j++){
+                row[j] ^= MultUint8(tables, a[i], prev[j]);
+            }
         }
+        row[k] ^= cfg->c;
+    }
+    for(size_t i = 0; i < k * width; i++){
+        cfg->step[i] = tables->log[rows[k * width + i]];
+    }
 
-        /* сдвигаем буфер на один элемент назад */
-        if(i != 0){
-            tmp_x_i[i-1] = Copy(gen->x_i[i]);
+    kvfree(rows);
+    return 0;
+}
+
+/* строки матрицы независимы, внутренний цикл векторизуется */
+static void apply_matrix(struct generator *gen, uint16_t const *matrix)
+{
+    uint8_t k = gen->k;
+    size_t width = k + 1;
+    uint16_t const *row = matrix;
+    uint8_t const *exp = gen->tables->exp;
+
+    for(size_t j = 0; j < k; j++){
+        gen->logs[j] = gen->tables->log[gen->window[j]];
+    }
+    gen->logs[k] = 0; // log 1
+
+    for(size_t i = 0; i < k; i++, row += width){
+        uint8_t acc = 0;
+        for(size_t j = 0; j < width; j++){
+            acc ^= exp[row[j] + gen->logs[j]];
         }
+        gen->window[i] = acc;
+    }
+}
 
-        FieldElement tmp_x_n = x_n;
-        x_n = Add(summand, x_n);
-        FreeElement(tmp_x_n);
-        FreeElement(summand);
+static void block_step(struct generator *gen)
+{
+    apply_matrix(gen, gen->step);
+    gen->pos = 0;
+}
 
-        if(x_n == NULL) {
-            free_elem_buff_if_necessary(tmp_x_i, gen->k);
-            return -1;
+/* n x n byte matrices */
+static void matrix_mult(struct Uint8Tables const *tables, uint8_t *res,
+                        uint8_t const *lhs, uint8_t const *rhs, size_t n)
+{
+    memset(res, 0, n * n);
+    for(size_t i = 0; i < n; i++){
+        for(size_t l = 0; l < n; l++){
+            uint8_t a = lhs[i * n + l];
+            if(a == 0) continue;
+            for(size_t j = 0; j < n; j++){
+                res[i * n + j] ^= MultUint8(tables, a, rhs[l * n + j]);
+            }
         }
     }
-    FieldElement tmp = x_n;
-    x_n = Add(gen->c, x_n);
-    FreeElement(tmp);
+}
 
-    if(x_n == NULL){
-        free_elem_buff_if_necessary(tmp_x_i, gen->k);
+/*
+ * Step matrix extended by the row (0, ..., 0, 1) to a square one and raised
+ * to the power blocks: one product then skips blocks * k outputs.
+ */
+static int setup_jump(struct generator *gen, unsigned int blocks)
+{
+    uint8_t k = gen->k;
+    size_t n = k + 1;
+    uint8_t *base, *acc, *tmp;
+    uint16_t *jump;
+
+    base = (uint8_t *) kvmalloc_array(3 * n, n, GFP_KERNEL);
+    jump = (uint16_t *) kvmalloc_array(k * n, sizeof(uint16_t), GFP_KERNEL);
+    if(base == NULL || jump == NULL){
+        kvfree(base);
+        kvfree(jump);
         return -1;
     }
-    tmp_x_i[gen->k - 1] = x_n;
-    *target = ToUint8(x_n);
+    acc = base + n * n;
+    tmp = acc + n * n;
+
+    memset(acc, 0, n * n);
+    for(size_t i = 0; i < n; i++){
+        acc[i * n + i] = 1;
+    }
+    for(size_t i = 0; i < k * n; i++){
+        base[i] = gen->tables->exp[gen->step[i]];
+    }
+    memset(base + k * n, 0, n);
+    base[k * n + k] = 1;
 
-    __swap(FieldElement* ,tmp_x_i, gen->x_i);
-    free_elem_buff_if_necessary(tmp_x_i, gen->k);
+    for(unsigned int e = blocks; e > 0; e >>= 1){
+        if(e & 1){
+            matrix_mult(gen->tables, tmp, acc, base, n);
+            memcpy(acc, tmp, n * n);
+        }
+        if(e > 1){
+            matrix_mult(gen->tables, tmp, base, base, n);
+            memcpy(base, tmp, n * n);
+        }
+        cond_resched();
+    }
 
+    for(size_t i = 0; i < k * n; i++){
+        jump[i] = gen->tables->log[acc[i]];
+    }
+    kvfree(base);
+    kvfree(gen->jump);
+    gen->jump = jump;
+    gen->jump_blocks = blocks;
     return 0;
 }
 
+/*
+ * Hands the next stream segment to the caller instead of generating it:
+ * window[pos..k-1] followed by blocks * k outputs of the recurrence started
+ * from window. The generator skips past the segment with one product.
+ * Returns the segment length.
+ */
+ssize_t reserve_random(struct generator *gen, unsigned int blocks, uint8_t *window, uint8_t *pos)
+{
+    ssize_t len;
+    if(gen->k == 0 || gen->step == NULL || blocks == 0) return -1;
+    if(gen->jump_blocks != blocks && setup_jump(gen, blocks) < 0) return -1;
+
+    memcpy(window, gen->window, gen->k);
+    *pos = gen->pos;
+    len = (gen->k - gen->pos) + (ssize_t) blocks * gen->k;
+
+    apply_matrix(gen, gen->jump);
+    gen->pos = gen->k; // the new window is the tail of the segment
+    return len;
+}
+
 static int alloc_buffers(FieldElement **a_i, FieldElement **x_i, uint8_t k){
     *a_i = (FieldElement *) kzalloc(sizeof(FieldElement) * k, GFP_KERNEL);
     if(*a_i == NULL) return -1;
@@ -106,41 +294,329 @@ static int dealloc_buffers(FieldElement * a_i, FieldElement *x_i, uint8_t k) {
     return -1;
 }
 
+/* the running state of cfg from its seed, takes over the caller's reference */
+static int start_config(struct generator *gen, struct generator_config *cfg)
+{
+    uint8_t k = cfg->k;
+    FieldElement *tmp_a_i = NULL, *tmp_x_i = NULL, tmp_c = NULL;
 
-int init_random(struct generator *main_gen, const char __user *buff, size_t len)
+    if(cfg->step == NULL){
+        if(alloc_buffers(&tmp_a_i, &tmp_x_i, k) < 0) return -1;
+        for(size_t i = 0; i < k; i++){
+            tmp_a_i[i] = FromUint8(gen->field, cfg->data[i]);
+            tmp_x_i[i] = FromUint8(gen->field, cfg->data[k + i]);
+            if(tmp_a_i[i] == NULL || tmp_x_i[i] == NULL) return dealloc_buffers(tmp_a_i, tmp_x_i, k);
+        }
+        tmp_c = FromUint8(gen->field, cfg->c);
+        if(tmp_c == NULL) return dealloc_buffers(tmp_a_i, tmp_x_i, k);
+    } else {
+        memcpy(gen->window, cfg->data + k, k);
+    }
+    gen->pos = k; // the seed itself is not output
+
+    free_scalar(gen);
+    gen->a_i = tmp_a_i;
+    gen->x_i = tmp_x_i;
+    gen->c_elem = tmp_c;
+    gen->k = k;
+    gen->a = cfg->data;
+    gen->c = cfg->c;
+    gen->step = cfg->step;
+    gen->jump_blocks = 0; // the cached jump belongs to the old seed
+    if(gen->cur != NULL) put_config(gen->cur);
+    gen->cur = cfg;
+    return 0;
+}
+
+int sync_generator(struct generator *gen)
 {
-    uint8_t k;
-    if(get_user(k,buff)) return -1;
-    FieldElement *tmp_a_i, *tmp_x_i;
-    if(alloc_buffers(&tmp_a_i, &tmp_x_i, k) < 0) return -1;
+    struct generator_config *cfg;
 
-    for(size_t i = 1; i <= k ; i++){
-        uint8_t a,x;
-        if(get_user(a, buff + i) || get_user(x, buff + i + k)) return dealloc_buffers(tmp_a_i, tmp_x_i, k);
+    rcu_read_lock();
+    do {
+        cfg = rcu_dereference(gen->config);
+        if(cfg == gen->cur || cfg == NULL){
+            rcu_read_unlock();
+            return 0;
+        }
+        /* ноль - конфигурацию уже заменили, перечитываем указатель */
+    } while(!kref_get_unless_zero(&cfg->ref));
+    rcu_read_unlock();
 
-        tmp_a_i[i-1] = FromUint8(main_gen->field, a);
-        tmp_x_i[i-1] = FromUint8(main_gen->field, x);
+    if(start_config(gen, cfg) < 0){
+        put_config(cfg);
+        return -1;
+    }
+    return 1;
+}
 
-        if(tmp_a_i[i-1] == NULL || tmp_x_i[i-1] == NULL) return dealloc_buffers(tmp_a_i, tmp_x_i, k);
+int fill_random(struct generator *gen, uint8_t *target, size_t len)
+{
+    if(gen->k == 0) return -1; // not seeded yet
+    if(gen->step == NULL){
+        size_t n = 0;
+        /* после restore_random сначала отдаём остаток окна */
+        for(; n < len && gen->pos < gen->k; n++){
+            target[n] = ToUint8(gen->x_i[gen->pos++]);
+        }
+        for(; n < len; n++){
+            if(scalar_step(gen, target + n) < 0) return -1;
+        }
+        return 0;
     }
+    while(len > 0){
+        size_t n;
+        if(gen->pos == gen->k) block_step(gen);
+        n = min_t(size_t, len, gen->k - gen->pos);
+        memcpy(target, gen->window + gen->pos, n);
+        gen->pos += n;
+        target += n;
+        len -= n;
+    }
+    return 0;
+}
 
-    uint8_t c;
-    if(get_user(c, buff + 2*k + 1)) return dealloc_buffers(tmp_a_i, tmp_x_i, k);
+int get_random(struct generator *gen, uint8_t *target)
+{
+    return fill_random(gen, target, 1);
+}
 
-    FieldElement tmp_c = FromUint8(main_gen->field, c);
+/* buff: k, a_0, ... , a_k-1, x_0, ... , x_k-1, c */
+struct generator_config *create_config(struct generator const *gen, const uint8_t *buff, size_t len)
+{
+    struct generator_config *cfg;
+    uint8_t k;
+    if(len < 1) return NULL;
+    k = buff[0];
+    if(k == 0 || len < 2 * (size_t) k + 2) return NULL;
 
-    if(tmp_c == NULL) return dealloc_buffers(tmp_a_i, tmp_x_i, k);
+    cfg = (struct generator_config *) kmalloc(struct_size(cfg, data, 2 * k), GFP_KERNEL);
+    if(cfg == NULL) return NULL;
+    cfg->k = k;
+    cfg->c = buff[2 * k + 1];
+    cfg->step = NULL;
+    memcpy(cfg->data, buff + 1, 2 * k);
+    kref_init(&cfg->ref);
 
-    __swap(FieldElement *, tmp_a_i, main_gen->a_i)
-    free_elem_buff_if_necessary(tmp_a_i,main_gen->k);
+    /* при нехватке памяти остаёмся в пошаговом режиме */
+    if(gen->tables != NULL && setup_block(cfg, gen->tables) < 0){
+        pr_warn("chardev: block mode unavailable for k = %d\n", k);
+    }
+    return cfg;
+}
+
+/* читатели в процессе остаются на старом seed до своего следующего вызова */
+void publish_config(struct generator *gen, struct generator_config *cfg)
+{
+    struct generator_config *old = unrcu_pointer(xchg(&gen->config, RCU_INITIALIZER(cfg)));
+    if(old != NULL) put_config(old);
+}
+
+int seed_random(struct generator *gen, const uint8_t *buff, size_t len)
+{
+    struct generator_config *cfg = create_config(gen, buff, len);
+    if(cfg == NULL) return -1;
+    publish_config(gen, cfg);
+    return 0;
+}
+
+int save_random(struct generator *gen, uint8_t *seed, uint8_t *pos)
+{
+    uint8_t k;
+    if(gen->k == 0) return -1;
+    k = gen->k;
+    seed[0] = k;
+    memcpy(seed + 1, gen->a, k);
+    for(size_t i = 0; i < k; i++){
+        seed[1 + k + i] = gen->step != NULL ? gen->window[i] : ToUint8(gen->x_i[i]);
+    }
+    seed[2 * k + 1] = gen->c;
+    *pos = gen->pos;
+    return 2 * k + 2;
+}
+
+/* the running state continues from window x, step matrix and jump cache stay valid */
+static int set_window(struct generator *gen, const uint8_t *x, uint8_t pos)
+{
+    uint8_t k = gen->k;
+    if(gen->step != NULL){
+        memcpy(gen->window, x, k);
+    } else {
+        /* сначала все k элементов, при ошибке старое окно остаётся целым */
+        FieldElement *tmp_x_i = (FieldElement *) kzalloc(sizeof(FieldElement) * k, GFP_KERNEL);
+        if(tmp_x_i == NULL) return -1;
+        for(size_t i = 0; i < k; i++){
+            tmp_x_i[i] = FromUint8(gen->field, x[i]);
+            if(tmp_x_i[i] == NULL){
+                free_elem_buff_if_necessary(tmp_x_i, k);
+                return -1;
+            }
+        }
+        free_elem_buff_if_necessary(gen->x_i, k);
+        gen->x_i = tmp_x_i;
+    }
+    gen->pos = pos;
+    return 0;
+}
 
-    __swap(FieldElement *, tmp_x_i, main_gen->x_i)
-    free_elem_buff_if_necessary(tmp_x_i, main_gen->k);
+int restore_random(struct generator *gen, const uint8_t *seed, size_t len, uint8_t pos)
+{
+    struct generator_config *cfg, *prev;
+    uint8_t k;
+    if(len < 1) return -1;
+    k = seed[0];
+    if(k == 0 || len < 2 * (size_t) k + 2 || pos > k) return -1;
+    if(sync_generator(gen) < 0) return -1;
 
-    main_gen->k = k;
+    /* та же рекуррентность: матрицу шага не пересобираем, только окно, O(k) */
+    if(gen->k == k && gen->c == seed[2 * k + 1] && memcmp(gen->a, seed + 1, k) == 0){
+        return set_window(gen, seed + 1 + k, pos);
+    }
+    cfg = create_config(gen, seed, len);
+    if(cfg == NULL) return -1;
 
-    __swap(FieldElement, tmp_c, main_gen->c)
-    FreeElement(tmp_c);
+    /* ставим конфигурацию сами, без publish и sync: чужой seed не получит наш pos */
+    prev = gen->cur;
+    if(prev != NULL) kref_get(&prev->ref); // its address stays unique until the cmpxchg
+    kref_get(&cfg->ref); // one for the running state, one for gen->config
+    if(start_config(gen, cfg) < 0){
+        put_config(cfg);
+        put_config(cfg);
+        if(prev != NULL) put_config(prev);
+        return -1;
+    }
+    gen->pos = pos; // the new config starts from x already
 
+    /* sync must not switch back to prev; a write() since the sync above wins instead */
+    if(unrcu_pointer(cmpxchg(&gen->config, RCU_INITIALIZER(prev), RCU_INITIALIZER(cfg))) == prev){
+        if(prev != NULL) put_config(prev);
+    } else {
+        put_config(cfg);
+    }
+    if(prev != NULL) put_config(prev);
     return 0;
 }
+
+int init_random(struct generator *main_gen, const char __user *buff, size_t len)
+{
+    int res;
+    uint8_t *seed;
+    if(len > GENERATOR_SEED_MAX) return -1; // до копирования, len приходит от пользователя
+    seed = memdup_user(buff, len);
+    if(IS_ERR(seed)) return -1;
+    res = seed_random(main_gen, seed, len);
+    kfree(seed);
+    return res;
+}
+
+/* готовые генераторы: поле общее, буферы окна уже выделены */
+static DEFINE_SPINLOCK(pool_lock);
+static struct generator **pool;
+static unsigned int pool_count;
+
+/* back to the state right after setup, the field and the buffers are kept */
+static void reset_generator(struct generator *gen)
+{
+    struct generator_config *cfg = rcu_dereference_protected(xchg(&gen->config, NULL), true);
+    if(cfg != NULL) put_config(cfg);
+    if(gen->cur != NULL) put_config(gen->cur);
+    free_scalar(gen);
+    kvfree(gen->jump);
+    gen->cur = NULL;
+    gen->k = 0;
+    gen->a = NULL;
+    gen->c = 0;
+    gen->step = NULL;
+    gen->pos = 0;
+    gen->jump = NULL;
+    gen->jump_blocks = 0;
+    gen->tables = block_mode ? gen->field->tables : NULL;
+}
+
+void fill_generator_pool(void)
+{
+    FiniteField field = CreateF_q(2, 8, irreducible);
+    struct generator **slots = (struct generator **) kcalloc(pool_size, sizeof(*slots), GFP_KERNEL);
+    unsigned int n = 0;
+
+    if(field == NULL || slots == NULL) goto out;
+    for(; n < pool_size; n++){
+        slots[n] = (struct generator *) kmalloc(sizeof(struct generator), GFP_KERNEL);
+        if(slots[n] == NULL) break;
+        if(setup_with_field(slots[n], HoldField(field)) < 0){
+            kfree(slots[n]);
+            break;
+        }
+    }
+    spin_lock(&pool_lock);
+    if(pool == NULL){
+        pool = slots;
+        pool_count = n;
+        slots = NULL;
+    }
+    spin_unlock(&pool_lock);
+    if(n < pool_size) pr_warn("chardev: %u of %u pooled generators\n", n, pool_size);
+
+out:
+    /* пул уже был заполнен */
+    if(slots != NULL){
+        for(unsigned int i = 0; i < n; i++){
+            free_generator(slots[i]);
+            kfree(slots[i]);
+        }
+        kfree(slots);
+    }
+    if(field != NULL) FreeField(field);
+}
+
+void drain_generator_pool(void)
+{
+    struct generator **slots;
+    unsigned int n;
+
+    spin_lock(&pool_lock);
+    slots = pool;
+    n = pool_count;
+    pool = NULL;
+    pool_count = 0;
+    spin_unlock(&pool_lock);
+    for(unsigned int i = 0; i < n; i++){
+        free_generator(slots[i]);
+        kfree(slots[i]);
+    }
+    kfree(slots);
+}
+
+struct generator *take_generator(void)
+{
+    struct generator *gen = NULL;
+
+    spin_lock(&pool_lock);
+    if(pool_count > 0) gen = pool[--pool_count];
+    spin_unlock(&pool_lock);
+    if(gen != NULL) return gen;
+
+    /* пул пуст: собираем как раньше */
+    gen = (struct generator *) kmalloc(sizeof(struct generator), GFP_KERNEL);
+    if(gen != NULL && setup_generator(gen) < 0){
+        kfree(gen);
+        return NULL;
+    }
+    return gen;
+}
+
+void put_generator(struct generator *gen)
+{
+    if(gen == NULL) return;
+    reset_generator(gen);
+    spin_lock(&pool_lock);
+    if(pool != NULL && pool_count < pool_size){
+        pool[pool_count++] = gen;
+        gen = NULL;
+    }
+    spin_unlock(&pool_lock);
+    if(gen != NULL){
+        free_generator(gen);
+        kfree(gen);
+    }
+}
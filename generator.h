@@ -1,17 +1,86 @@
 #ifndef DRIVER_GENERATOR_H
 #define DRIVER_GENERATOR_H
+#include <linux/kref.h>
+#include <linux/rcupdate.h>
 #include "finite_fields.h"
 
+/* seed and the tables derived from it, immutable once published */
+struct generator_config {
+    uint8_t k;
+    uint8_t c;
+    uint16_t *step;  // k x (k+1), logs of the k-step transition matrix, row-major; NULL in scalar mode
+    struct kref ref;
+    struct rcu_head rcu;
+    uint8_t data[];  // a_0, ... , a_k-1, x_0, ... , x_k-1
+};
+
+/*
+ * seed_random() only publishes a new config, readers switch to it with
+ * sync_generator(), once per operation. Everything below config is the
+ * running state: fill, reserve and save use it as is, and calls that
+ * generate on one generator must be serialized by the caller.
+ */
 struct generator {
+    FiniteField field;
+    struct Uint8Tables *tables; // borrowed from field, NULL forces scalar mode
+    struct generator_config __rcu *config; // last published seed
+
+    struct generator_config *cur; // seed the running state was started from, referenced
     uint8_t k;
+    uint8_t const *a; // a_0, ... , a_k-1 of cur
+    uint8_t c;
+    uint16_t const *step; // cur->step
+
+    /* пошаговый режим */
     FieldElement *a_i;
     FieldElement *x_i;
-    FieldElement c;
-    FiniteField field;
+    FieldElement c_elem;
+
+    /* блочный режим: k выходов за одно умножение матрицы на вектор */
+    uint8_t *window; // current x_i as bytes, also the last k outputs
+    uint16_t *logs;  // k+1 scratch logs of (window, 1)
+    uint8_t pos;     // first window byte not yet handed out
+    uint16_t *jump;  // logs of the step matrix to the power jump_blocks, for reserve_random
+    unsigned int jump_blocks;
 };
 
 int setup_generator(struct generator *gen);
 void free_generator(struct generator *gen);
 int get_random(struct generator *gen, uint8_t *target);
+int fill_random(struct generator *gen, uint8_t *target, size_t len);
+ssize_t reserve_random(struct generator *gen, unsigned int blocks, uint8_t *window, uint8_t *pos);
+int seed_random(struct generator *gen, const uint8_t *buff, size_t len);
+/* longest valid seed: k = 255, a_i, x_i and c */
+#define GENERATOR_SEED_MAX (2 * 255 + 2)
+
 int init_random(struct generator *gen, const char __user *buff, size_t len);
+
+/*
+ * Checkpoints in the seed layout: k, a_i, the current window x_0..x_k-1, c.
+ * x_pos..x_k-1 are the next outputs, then the recurrence continues from x.
+ * save returns the length, 2k + 2 of at most GENERATOR_SEED_MAX bytes. restore replaces
+ * the running state at once and must be serialized like generation; with
+ * the same k, a_i and c as running it only moves the window. A seed published
+ * while restore runs is not overwritten, it takes over at the next sync.
+ */
+int save_random(struct generator *gen, uint8_t *seed, uint8_t *pos);
+int restore_random(struct generator *gen, const uint8_t *seed, size_t len, uint8_t pos);
+
+/* seed_random in two steps: build without touching gen, then publish */
+struct generator_config *create_config(struct generator const *gen, const uint8_t *buff, size_t len);
+void publish_config(struct generator *gen, struct generator_config *cfg);
+void put_config(struct generator_config *cfg);
+
+/* switches the running state to the last published seed, 1 if it did; never sleeps in block mode */
+int sync_generator(struct generator *gen);
+
+/*
+ * Module-lifetime pool of set up generators, pool_size of them. take falls
+ * back to a fresh setup when the pool is empty, put returns an unseeded
+ * generator to the pool or frees it when the pool is full.
+ */
+void fill_generator_pool(void);
+void drain_generator_pool(void);
+struct generator *take_generator(void);
+void put_generator(struct generator *gen);
 #endif //DRIVER_GENERATOR_H
@@ -0,0 +1,167 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "../chardriver_ioctl.h"
+#include "libchardriver.h"
+
+/*
+ * gcc -O2 -c lib/libchardriver.c
+ * same recurrence as get_random(), GF(2^n) products through log/exp tables
+ */
+
+#define LOG_ZERO 511
+
+struct chardriver_stream {
+    int fd;
+    int own_fd;
+    struct chardriver_page const *page;
+    uint16_t modulus;
+    uint16_t log[256];
+    uint8_t exp[2 * LOG_ZERO + 1];
+    uint8_t k;
+    uint8_t c;
+    uint16_t a_log[255];
+    uint8_t x[255];     // ring buffer of the last k values
+    uint8_t head;       // oldest value in x
+    uint8_t pending;    // x[pending..k-1] of the segment window not yet returned
+    uint64_t left;      // outputs of the current segment not yet returned
+};
+
+static uint8_t clmul_mod(uint8_t lhs, uint8_t rhs, uint16_t modulus, int deg)
+{
+    uint16_t res = 0, shifted = lhs;
+    for (; rhs > 0; rhs >>= 1) {
+        if (rhs & 1) res ^= shifted;
+        shifted <<= 1;
+        if (shifted & (1 << deg)) shifted ^= modulus;
+    }
+    return res;
+}
+
+static int build_tables(struct chardriver_stream *s, uint16_t modulus)
+{
+    int deg, order, g, i;
+    uint8_t value;
+
+    if (modulus < 2) return -1;
+    deg = 31 - __builtin_clz(modulus);
+    if (deg > 8) return -1;
+    order = (1 << deg) - 1;
+    for (g = 1; g <= order; g++) {
+        value = g;
+        for (i = 1; value != 1 && i <= order; i++) value = clmul_mod(value, g, modulus, deg);
+        if (i == order) break;
+    }
+    if (g > order) return -1;
+
+    for (i = 0; i < 256; i++) s->log[i] = LOG_ZERO;
+    value = 1;
+    for (i = 0; i < order; i++) {
+        s->exp[i] = value;
+        s->log[value] = i;
+        value = clmul_mod(value, g, modulus, deg);
+    }
+    for (i = order; i < 2 * LOG_ZERO + 1; i++) {
+        s->exp[i] = i < 2 * order ? s->exp[i - order] : 0;
+    }
+    s->modulus = modulus;
+    return 0;
+}
+
+/* новый отрезок: ioctl, затем чтение страницы под seq */
+static int reserve(struct chardriver_stream *s)
+{
+    struct chardriver_page const *page = s->page;
+    struct chardriver_reserve res;
+    struct chardriver_page copy;
+    uint32_t seq;
+
+    for (;;) {
+        if (ioctl(s->fd, CHARDRIVER_IOC_RESERVE, &res) < 0) return -1;
+        do {
+            seq = __atomic_load_n(&page->seq, __ATOMIC_ACQUIRE);
+            memcpy(&copy, page, sizeof(copy));
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        } while ((seq & 1) || __atomic_load_n(&page->seq, __ATOMIC_RELAXED) != seq);
+        /* страницу уже переписал другой резерв - этот отрезок пропускаем */
+        if (seq == res.seq) break;
+    }
+
+    if (copy.modulus != s->modulus && build_tables(s, copy.modulus) < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    s->k = copy.k;
+    s->c = copy.c;
+    for (int i = 0; i < s->k; i++) s->a_log[i] = s->log[copy.a[i]];
+    memcpy(s->x, copy.x, s->k);
+    s->head = 0;
+    s->pending = copy.pos;
+    s->left = copy.len;
+    return 0;
+}
+
+static uint8_t next(struct chardriver_stream *s)
+{
+    uint8_t x_n = s->c;
+    if (s->pending < s->k) return s->x[s->pending++];
+    for (int i = 0, j = s->head; i < s->k; i++, j = j + 1 == s->k ? 0 : j + 1) {
+        x_n ^= s->exp[s->a_log[i] + s->log[s->x[j]]];
+    }
+    s->x[s->head] = x_n;
+    s->head = s->head + 1 == s->k ? 0 : s->head + 1;
+    return x_n;
+}
+
+ssize_t chardriver_read(struct chardriver_stream *s, void *buf, size_t len)
+{
+    uint8_t *out = buf;
+    for (size_t n = 0; n < len; n++) {
+        if (s->left == 0 && reserve(s) < 0) return n > 0 ? (ssize_t) n : -1;
+        out[n] = next(s);
+        s->left--;
+    }
+    return len;
+}
+
+struct chardriver_stream *chardriver_attach(int fd)
+{
+    struct chardriver_stream *s = calloc(1, sizeof(*s));
+    void *page;
+    if (s == NULL) return NULL;
+    page = mmap(NULL, sysconf(_SC_PAGESIZE), PROT_READ, MAP_SHARED, fd, 0);
+    if (page == MAP_FAILED) {
+        free(s);
+        return NULL;
+    }
+    s->fd = fd;
+    s->page = page;
+    return s;
+}
+
+struct chardriver_stream *chardriver_open(const char *path, const unsigned char *seed, size_t seed_len)
+{
+    struct chardriver_stream *s;
+    int fd = open(path, O_RDWR);
+    if (fd == -1) return NULL;
+    if ((seed != NULL && write(fd, seed, seed_len) != (ssize_t) seed_len) || (s = chardriver_attach(fd)) == NULL) {
+        close(fd);
+        return NULL;
+    }
+    s->own_fd = 1;
+    return s;
+}
+
+void chardriver_close(struct chardriver_stream *s)
+{
+    if (s == NULL) return;
+    munmap((void *) s->page, sysconf(_SC_PAGESIZE));
+    if (s->own_fd) close(s->fd);
+    free(s);
+}
@@ -0,0 +1,28 @@
+#ifndef LIBCHARDRIVER_H
+#define LIBCHARDRIVER_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+/*
+ * Userspace fast path for /dev/chardev: the stream is generated locally from
+ * segments the driver reserves through CHARDRIVER_IOC_RESERVE and publishes in
+ * a read-only mapped page, the kernel is entered once per segment.
+ *
+ * struct chardriver_stream *s = chardriver_open("/dev/chardev", seed, seed_len);
+ * chardriver_read(s, buf, len);
+ * chardriver_close(s);
+ *
+ * A stream is not thread safe. Segments are never handed out twice, so
+ * several streams on one fd (threads, fork) get disjoint parts of the stream.
+ */
+
+struct chardriver_stream;
+
+// seed as for write(/dev/chardev); NULL seed keeps the current one of fd
+struct chardriver_stream *chardriver_open(const char *path, const unsigned char *seed, size_t seed_len);
+struct chardriver_stream *chardriver_attach(int fd);
+ssize_t chardriver_read(struct chardriver_stream *s, void *buf, size_t len);
+void chardriver_close(struct chardriver_stream *s);
+
+#endif //LIBCHARDRIVER_H
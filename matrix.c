@@ -0,0 +1,519 @@
+#include "matrix.h"
+#include "binary_field_extension.h"
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+
+// MultMatrix works on BLOCK_ROWS x BLOCK_COLS pieces of rhs, 32 KiB of logs in the table case
+#define BLOCK_ROWS 64
+#define BLOCK_COLS 256
+
+// arithmetic on packed elements
+struct packed {
+    struct Uint8Tables const *tables; // GF(2^n), n <= 8: bytes, NULL for coefficient vectors
+    uint16_t order;
+    uint8_t p;
+    uint8_t m;           // element size
+    uint8_t lead_inv;    // inverse of the modulus' leading coefficient
+    uint8_t const *pol;  // modulus, m + 1 coefficients
+    uint8_t *matrix;     // m x m, multiplication by one element
+    uint8_t *tmp;
+    uint8_t *inv;
+    uint64_t low;        // p = 2, m <= 64: modulus without t^m as a bit mask
+    uint64_t *basis;     // p = 2, m <= 64: x * t^s mod pol as bit masks, NULL otherwise
+};
+
+static uint8_t inverse_mod(uint8_t a, uint8_t p) {
+    for (uint16_t c = 1; c < p; c++) {
+        if (c * a % p == 1) return c;
+    }
+    return 0;
+}
+
+static uint8_t element_size(FiniteField f) {
+    return f->tables != NULL ? 1 : PolynomDeg(f->pol);
+}
+
+static bool setup_packed(struct packed *pk, FiniteField f) {
+    pk->tables = f->tables;
+    pk->order = f->order;
+    pk->p = f->p;
+    pk->m = element_size(f);
+    pk->pol = f->pol->coefficients;
+    pk->lead_inv = inverse_mod(pk->pol[PolynomDeg(f->pol)], pk->p);
+    pk->matrix = (uint8_t *) kmalloc(pk->m * pk->m + 2 * pk->m, GFP_KERNEL);
+    if (pk->matrix == NULL) return false;
+    pk->tmp = pk->matrix + pk->m * pk->m;
+    pk->inv = pk->tmp + pk->m;
+    pk->basis = NULL;
+    if (pk->p == 2 && pk->tables == NULL && pk->m <= 64) {
+        pk->basis = (uint64_t *) kmalloc_array(pk->m, sizeof(uint64_t), GFP_KERNEL);
+        if (pk->basis == NULL) {
+            kfree(pk->matrix);
+            return false;
+        }
+        pk->low = 0;
+        for (uint8_t s = 0; s < pk->m; s++) pk->low |= (uint64_t) pk->pol[s] << s;
+    }
+    return true;
+}
+
+static void free_packed(struct packed *pk) {
+    kfree(pk->basis);
+    kfree(pk->matrix);
+}
+
+/*
+ * p = 2: an element is a bit mask, multiplication by x is XOR of the
+ * pk->basis masks picked by the bits of the other factor
+ */
+static void build_basis(struct packed *pk, uint8_t const *x) {
+    uint64_t top = 1ull << (pk->m - 1), v = 0;
+    for (uint8_t s = 0; s < pk->m; s++) v |= (uint64_t) x[s] << s;
+    for (uint8_t s = 0; s < pk->m; s++) {
+        pk->basis[s] = v;
+        v = v & top ? ((v ^ top) << 1) ^ pk->low : v << 1;
+    }
+}
+
+static uint64_t mult_basis(struct packed const *pk, uint8_t const *y) {
+    uint64_t res = 0;
+    for (uint8_t s = 0; s < pk->m; s++) res ^= pk->basis[s] & (0 - (uint64_t) y[s]);
+    return res;
+}
+
+// carry-less x * y reduced by pol, Horner over the bits of y
+static uint64_t mult_mask(struct packed const *pk, uint64_t x, uint64_t y) {
+    uint64_t top = 1ull << (pk->m - 1), res = 0;
+    for (uint8_t s = pk->m; s-- > 0;) {
+        res = res & top ? ((res ^ top) << 1) ^ pk->low : res << 1;
+        res ^= x & (0 - ((y >> s) & 1));
+    }
+    return res;
+}
+
+// multiplication by x as a matrix, column j is x * t^j mod pol
+static void build_matrix(struct packed *pk, uint8_t const *x) {
+    uint8_t m = pk->m, p = pk->p;
+    for (uint8_t i = 0; i < m; i++) pk->matrix[i * m] = x[i];
+    for (uint8_t j = 1; j < m; j++) {
+        uint8_t top = pk->matrix[(m - 1) * m + j - 1] * pk->lead_inv % p;
+        for (uint8_t i = 0; i < m; i++) {
+            uint8_t shifted = i == 0 ? 0 : pk->matrix[(i - 1) * m + j - 1];
+            pk->matrix[i * m + j] = (shifted + (p - top) * pk->pol[i]) % p;
+        }
+    }
+}
+
+static bool is_zero(uint8_t const *x, uint8_t size) {
+    for (uint8_t i = 0; i < size; i++) {
+        if (x[i] != 0) return false;
+    }
+    return true;
+}
+
+static uint8_t *at(Matrix a, uint32_t i, uint32_t j) {
+    return a->data + ((size_t) i * a->cols + j) * a->elem_size;
+}
+
+static FieldElement to_element(FiniteField f, uint8_t const *x, uint8_t m) {
+    FieldElement elem;
+    int *coeffs;
+
+    if (f->tables != NULL) return FromUint8(f, *x);
+    coeffs = (int *) kmalloc_array(m, sizeof(int), GFP_KERNEL);
+    if (coeffs == NULL) return NULL;
+    for (uint8_t j = 0; j < m; j++) coeffs[m - 1 - j] = x[j]; // big-endian
+    elem = GetFromArray(f, coeffs, m);
+    kfree(coeffs);
+    return elem;
+}
+
+static void load(FieldElement elem, uint8_t *out, uint8_t m) {
+    if (elem->field->tables != NULL) {
+        *out = ToUint8(elem);
+        return;
+    }
+    memset(out, 0, m);
+    memcpy(out, elem->pol->coefficients, min_t(uint8_t, elem->pol->coeff_size, m));
+}
+
+// pk->inv = x^(-1), x is not zero
+static bool invert(struct packed *pk, FiniteField f, uint8_t const *x) {
+    FieldElement elem, inv;
+
+    if (pk->tables != NULL) {
+        *pk->inv = pk->tables->exp[pk->order - pk->tables->log[*x]];
+        return true;
+    }
+    if (pk->basis != NULL) { // x^(2^m - 2) = (x^(2^(m-1) - 1))^2
+        uint64_t v = 0, r;
+        for (uint8_t s = 0; s < pk->m; s++) v |= (uint64_t) x[s] << s;
+        r = v;
+        for (uint8_t s = 2; s < pk->m; s++) r = mult_mask(pk, mult_mask(pk, r, r), v);
+        r = mult_mask(pk, r, r);
+        for (uint8_t s = 0; s < pk->m; s++) pk->inv[s] = (r >> s) & 1;
+        return true;
+    }
+    elem = to_element(f, x, pk->m);
+    if (elem == NULL) return false;
+    inv = Inv(elem); // NULL when the field order does not fit
+    FreeElement(elem);
+    if (inv == NULL) return false;
+    load(inv, pk->inv, pk->m);
+    FreeElement(inv);
+    return true;
+}
+
+// row *= pk->inv over len elements
+static void scale_row(struct packed *pk, uint8_t *row, uint32_t len) {
+    uint8_t m = pk->m, p = pk->p;
+
+    if (pk->tables != NULL) {
+        uint16_t lf = pk->tables->log[*pk->inv];
+        for (uint32_t j = 0; j < len; j++) row[j] = pk->tables->exp[pk->tables->log[row[j]] + lf];
+        return;
+    }
+    if (pk->basis != NULL) {
+        build_basis(pk, pk->inv);
+        for (uint32_t j = 0; j < len; j++, row += m) {
+            uint64_t v = mult_basis(pk, row);
+            for (uint8_t s = 0; s < m; s++) row[s] = (v >> s) & 1;
+        }
+        return;
+    }
+    build_matrix(pk, pk->inv);
+    for (uint32_t j = 0; j < len; j++, row += m) {
+        for (uint8_t i = 0; i < m; i++) {
+            uint32_t sum = 0;
+            for (uint8_t s = 0; s < m; s++) sum += (uint32_t) pk->matrix[i * m + s] * row[s];
+            pk->tmp[i] = sum % p;
+        }
+        memcpy(row, pk->tmp, m);
+    }
+}
+
+/*
+ * row -= row[0] * pivot over len elements, pivot[0] is one. With tables the
+ * pivot comes as logs computed once for all rows, one lookup per byte.
+ */
+static void sub_scaled(struct packed *pk, uint8_t *row, uint8_t const *pivot, uint16_t const *logs, uint32_t len) {
+    uint8_t m = pk->m, p = pk->p;
+
+    if (pk->tables != NULL) {
+        uint16_t lf = pk->tables->log[*row];
+        for (uint32_t j = 0; j < len; j++) row[j] ^= pk->tables->exp[logs[j] + lf];
+        return;
+    }
+    if (pk->basis != NULL) { // -row[0] = row[0]
+        build_basis(pk, row);
+        for (uint32_t j = 0; j < len; j++, row += m, pivot += m) {
+            uint64_t v;
+            if (is_zero(pivot, m)) continue;
+            v = mult_basis(pk, pivot);
+            for (uint8_t s = 0; s < m; s++) row[s] ^= (v >> s) & 1;
+        }
+        return;
+    }
+    for (uint8_t i = 0; i < m; i++) pk->tmp[i] = (p - row[i]) % p;
+    build_matrix(pk, pk->tmp);
+    for (uint32_t j = 0; j < len; j++, row += m, pivot += m) {
+        if (is_zero(pivot, m)) continue;
+        for (uint8_t i = 0; i < m; i++) {
+            uint32_t sum = row[i]; // 255 * 254^2 still fits
+            for (uint8_t s = 0; s < m; s++) sum += (uint32_t) pk->matrix[i * m + s] * pivot[s];
+            row[i] = sum % p;
+        }
+    }
+}
+
+static void swap_rows(uint8_t *lhs, uint8_t *rhs, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        uint8_t tmp = lhs[i];
+        lhs[i] = rhs[i];
+        rhs[i] = tmp;
+    }
+}
+
+// pivots only in the first cols columns, the rest of each row follows along
+static int reduce(Matrix a, uint32_t cols) {
+    struct packed pk;
+    uint16_t *logs = NULL;
+    uint8_t size = a->elem_size;
+    uint32_t rank = 0;
+
+    if (!setup_packed(&pk, a->field)) return -1;
+    if (pk.tables != NULL) {
+        logs = (uint16_t *) kvmalloc_array(a->cols, sizeof(uint16_t), GFP_KERNEL);
+        if (logs == NULL) goto fail;
+    }
+    for (uint32_t col = 0; col < cols && rank < a->rows; col++) {
+        uint32_t len = a->cols - col, r = rank;
+        uint8_t *pivot;
+
+        while (r < a->rows && is_zero(at(a, r, col), size)) r++;
+        if (r == a->rows) continue;
+        if (r != rank) swap_rows(at(a, r, 0), at(a, rank, 0), (size_t) a->cols * size);
+        // rows from rank on are zero left of col, so is the pivot row
+        pivot = at(a, rank, col);
+        if (!invert(&pk, a->field, pivot)) goto fail;
+        scale_row(&pk, pivot, len);
+        if (logs != NULL) {
+            for (uint32_t j = 0; j < len; j++) logs[j] = pk.tables->log[pivot[j]];
+        }
+        for (uint32_t i = 0; i < a->rows; i++) {
+            uint8_t *row = at(a, i, col);
+            if (i == rank || is_zero(row, size)) continue;
+            sub_scaled(&pk, row, pivot, logs, len);
+        }
+        rank++;
+    }
+    kvfree(logs);
+    free_packed(&pk);
+    return rank;
+
+fail:
+    kvfree(logs);
+    free_packed(&pk);
+    return -1;
+}
+
+Matrix CreateMatrix(FiniteField f, uint32_t rows, uint32_t cols) {
+    Matrix a;
+
+    if (rows == 0 || cols == 0 || rows > INT_MAX) return NULL;
+    a = (Matrix) kmalloc(sizeof(struct Matrix), GFP_KERNEL);
+    if (a == NULL) return NULL;
+    a->elem_size = element_size(f);
+    a->data = (uint8_t *) kvcalloc((size_t) rows * cols, a->elem_size, GFP_KERNEL);
+    if (a->data == NULL) {
+        kfree(a);
+        return NULL;
+    }
+    a->field = HoldField(f);
+    a->rows = rows;
+    a->cols = cols;
+    return a;
+}
+
+Matrix IdentityMatrix(FiniteField f, uint32_t n) {
+    Matrix a = CreateMatrix(f, n, n);
+    if (a == NULL) return NULL;
+    for (uint32_t i = 0; i < n; i++) *at(a, i, i) = 1; // 1 as a byte and as coefficients
+    return a;
+}
+
+Matrix CopyMatrix(Matrix a) {
+    Matrix res = CreateMatrix(a->field, a->rows, a->cols);
+    if (res == NULL) return NULL;
+    memcpy(res->data, a->data, (size_t) a->rows * a->cols * a->elem_size);
+    return res;
+}
+
+FieldElement GetMatrixElement(Matrix a, uint32_t i, uint32_t j) {
+    if (i >= a->rows || j >= a->cols) return NULL;
+    return to_element(a->field, at(a, i, j), a->elem_size);
+}
+
+int SetMatrixElement(Matrix a, uint32_t i, uint32_t j, FieldElement value) {
+    if (i >= a->rows || j >= a->cols || !AreEqualFields(a->field, value->field)) return -1;
+    load(value, at(a, i, j), a->elem_size);
+    return 0;
+}
+
+bool AreEqualMatrices(Matrix lhs, Matrix rhs) {
+    return AreEqualFields(lhs->field, rhs->field) && lhs->rows == rhs->rows && lhs->cols == rhs->cols &&
+           memcmp(lhs->data, rhs->data, (size_t) lhs->rows * lhs->cols * lhs->elem_size) == 0;
+}
+
+// res += lhs * rhs, a row of lhs times a block of rhs rows is a run of row scale-and-adds
+static void mult_tables(Matrix lhs, Matrix rhs, Matrix res, uint16_t *logs) {
+    struct Uint8Tables const *tables = lhs->field->tables;
+    uint32_t n = rhs->cols;
+
+    for (size_t i = 0; i < (size_t) rhs->rows * n; i++) logs[i] = tables->log[rhs->data[i]];
+    for (uint32_t k0 = 0; k0 < rhs->rows; k0 += BLOCK_ROWS) {
+        uint32_t k1 = min_t(uint32_t, rhs->rows, k0 + BLOCK_ROWS);
+        for (uint32_t j0 = 0; j0 < n; j0 += BLOCK_COLS) {
+            uint32_t len = min_t(uint32_t, n - j0, BLOCK_COLS);
+            for (uint32_t i = 0; i < lhs->rows; i++) {
+                uint8_t const *row = at(lhs, i, 0);
+                uint8_t *out = at(res, i, j0);
+                for (uint32_t k = k0; k < k1; k++) {
+                    uint16_t la = tables->log[row[k]];
+                    uint16_t const *lb = logs + (size_t) k * n + j0;
+                    if (la == UINT8_LOG_ZERO) continue;
+                    for (uint32_t j = 0; j < len; j++) out[j] ^= tables->exp[lb[j] + la];
+                }
+            }
+        }
+    }
+}
+
+// coefficient vectors, odd p: products summed without reduction over a block, acc holds BLOCK_COLS elements
+static void mult_packed(struct packed *pk, Matrix lhs, Matrix rhs, Matrix res, uint32_t *acc) {
+    uint8_t m = pk->m;
+    uint32_t n = rhs->cols;
+
+    for (uint32_t k0 = 0; k0 < rhs->rows; k0 += BLOCK_ROWS) {
+        uint32_t k1 = min_t(uint32_t, rhs->rows, k0 + BLOCK_ROWS);
+        for (uint32_t j0 = 0; j0 < n; j0 += BLOCK_COLS) {
+            uint32_t len = min_t(uint32_t, n - j0, BLOCK_COLS);
+            for (uint32_t i = 0; i < lhs->rows; i++) {
+                uint8_t *out = at(res, i, j0);
+                memset(acc, 0, (size_t) len * m * sizeof(uint32_t));
+                for (uint32_t k = k0; k < k1; k++) {
+                    uint8_t const *x = at(lhs, i, k), *b = at(rhs, k, j0);
+                    uint32_t *sum = acc;
+                    if (is_zero(x, m)) continue;
+                    build_matrix(pk, x);
+                    for (uint32_t j = 0; j < len; j++, b += m, sum += m) {
+                        for (uint8_t r = 0; r < m; r++) {
+                            // BLOCK_ROWS * 255 * 254^2 still fits
+                            for (uint8_t s = 0; s < m; s++) sum[r] += (uint32_t) pk->matrix[r * m + s] * b[s];
+                        }
+                    }
+                }
+                for (size_t t = 0; t < (size_t) len * m; t++) out[t] = (out[t] + acc[t]) % pk->p;
+            }
+        }
+    }
+}
+
+// p = 2: acc holds BLOCK_COLS products as bit masks, XORed into res once per block
+static void mult_binary(struct packed *pk, Matrix lhs, Matrix rhs, Matrix res, uint64_t *acc) {
+    uint8_t m = pk->m;
+    uint32_t n = rhs->cols;
+
+    for (uint32_t k0 = 0; k0 < rhs->rows; k0 += BLOCK_ROWS) {
+        uint32_t k1 = min_t(uint32_t, rhs->rows, k0 + BLOCK_ROWS);
+        for (uint32_t j0 = 0; j0 < n; j0 += BLOCK_COLS) {
+            uint32_t len = min_t(uint32_t, n - j0, BLOCK_COLS);
+            for (uint32_t i = 0; i < lhs->rows; i++) {
+                uint8_t *out = at(res, i, j0);
+                memset(acc, 0, (size_t) len * sizeof(uint64_t));
+                for (uint32_t k = k0; k < k1; k++) {
+                    uint8_t const *x = at(lhs, i, k), *b = at(rhs, k, j0);
+                    if (is_zero(x, m)) continue;
+                    build_basis(pk, x);
+                    for (uint32_t j = 0; j < len; j++, b += m) acc[j] ^= mult_basis(pk, b);
+                }
+                for (uint32_t j = 0; j < len; j++, out += m) {
+                    for (uint8_t s = 0; s < m; s++) out[s] ^= (acc[j] >> s) & 1;
+                }
+            }
+        }
+    }
+}
+
+Matrix MultMatrix(Matrix lhs, Matrix rhs) {
+    struct packed pk;
+    Matrix res;
+    void *scratch;
+
+    if (lhs->cols != rhs->rows || !AreEqualFields(lhs->field, rhs->field)) return NULL;
+    res = CreateMatrix(lhs->field, lhs->rows, rhs->cols);
+    if (res == NULL) return NULL;
+    if (lhs->field->tables != NULL) {
+        scratch = kvmalloc_array((size_t) rhs->rows * rhs->cols, sizeof(uint16_t), GFP_KERNEL);
+        if (scratch == NULL) goto fail;
+        mult_tables(lhs, rhs, res, scratch);
+        kvfree(scratch);
+        return res;
+    }
+    if (!setup_packed(&pk, lhs->field)) goto fail;
+    if (pk.basis != NULL) {
+        scratch = kvmalloc_array(BLOCK_COLS, sizeof(uint64_t), GFP_KERNEL);
+    } else {
+        scratch = kvmalloc_array(BLOCK_COLS * pk.m, sizeof(uint32_t), GFP_KERNEL);
+    }
+    if (scratch == NULL) {
+        free_packed(&pk);
+        goto fail;
+    }
+    if (pk.basis != NULL) {
+        mult_binary(&pk, lhs, rhs, res, scratch);
+    } else {
+        mult_packed(&pk, lhs, rhs, res, scratch);
+    }
+    kvfree(scratch);
+    free_packed(&pk);
+    return res;
+
+fail:
+    FreeMatrix(res);
+    return NULL;
+}
+
+int RowReduce(Matrix a) {
+    return reduce(a, a->cols);
+}
+
+int MatrixRank(Matrix a) {
+    Matrix tmp = CopyMatrix(a);
+    int rank;
+    if (tmp == NULL) return -1;
+    rank = RowReduce(tmp);
+    FreeMatrix(tmp);
+    return rank;
+}
+
+// reduces (a | E), the right half ends up as the inverse
+Matrix InverseMatrix(Matrix a) {
+    uint32_t n = a->rows;
+    size_t row_size = (size_t) n * a->elem_size;
+    Matrix aug, res = NULL;
+    int rank;
+
+    if (a->rows != a->cols || n > U32_MAX / 2) return NULL;
+    aug = CreateMatrix(a->field, n, 2 * n);
+    if (aug == NULL) return NULL;
+    for (uint32_t i = 0; i < n; i++) {
+        memcpy(at(aug, i, 0), at(a, i, 0), row_size);
+        *at(aug, i, n + i) = 1;
+    }
+    rank = reduce(aug, n);
+    if (rank >= 0 && (uint32_t) rank == n) res = CreateMatrix(a->field, n, n);
+    if (res != NULL) {
+        for (uint32_t i = 0; i < n; i++) memcpy(at(res, i, 0), at(aug, i, n), row_size);
+    }
+    FreeMatrix(aug);
+    return res;
+}
+
+Matrix PowMatrix(Matrix a, uint64_t deg) {
+    Matrix res, base, tmp;
+
+    if (a->rows != a->cols) return NULL;
+    res = IdentityMatrix(a->field, a->rows);
+    base = CopyMatrix(a);
+    if (res == NULL || base == NULL) goto fail;
+    for (; deg != 0; deg >>= 1) {
+        if (deg & 1) {
+            tmp = MultMatrix(res, base);
+            FreeMatrix(res);
+            res = tmp;
+            if (res == NULL) goto fail;
+        }
+        if (deg > 1) {
+            tmp = MultMatrix(base, base);
+            FreeMatrix(base);
+            base = tmp;
+            if (base == NULL) goto fail;
+        }
+    }
+    FreeMatrix(base);
+    return res;
+
+fail:
+    FreeMatrix(res);
+    FreeMatrix(base);
+    return NULL;
+}
+
+void FreeMatrix(Matrix a) {
+    if (a == NULL) return;
+    FreeField(a->field);
+    kvfree(a->data);
+    kfree(a);
+}
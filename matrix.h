@@ -0,0 +1,47 @@
+#ifndef FINITEFIELDSHW_MATRIX_H
+#define FINITEFIELDSHW_MATRIX_H
+
+#include <linux/types.h>
+#include "finite_field.h"
+#include "field_element.h"
+
+// rows x cols over field, row-major in one block; an element takes elem_size bytes:
+// a byte for GF(2^n), n <= 8 (as in ToUint8), otherwise m coefficients over F_p, little-endian
+struct Matrix {
+    FiniteField field; // held
+    uint32_t rows;
+    uint32_t cols;
+    uint8_t elem_size;
+    uint8_t *data;
+};
+typedef struct Matrix *Matrix;
+
+// zero matrix, returns NULL if error occurred
+Matrix CreateMatrix(FiniteField f, uint32_t rows, uint32_t cols);
+
+Matrix IdentityMatrix(FiniteField f, uint32_t n);
+
+Matrix CopyMatrix(Matrix a);
+
+FieldElement GetMatrixElement(Matrix a, uint32_t i, uint32_t j);
+
+int SetMatrixElement(Matrix a, uint32_t i, uint32_t j, FieldElement value);
+
+bool AreEqualMatrices(Matrix lhs, Matrix rhs);
+
+// blocked, NULL if the sizes or fields do not match
+Matrix MultMatrix(Matrix lhs, Matrix rhs);
+
+// Gaussian elimination in place to reduced row echelon form, returns the rank or -1
+int RowReduce(Matrix a);
+
+int MatrixRank(Matrix a);
+
+// NULL if a is not square or singular
+Matrix InverseMatrix(Matrix a);
+
+Matrix PowMatrix(Matrix a, uint64_t deg);
+
+void FreeMatrix(Matrix a);
+
+#endif //FINITEFIELDSHW_MATRIX_H
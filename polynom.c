@@ -1,4 +1,5 @@
 #include "polynom.h"
+#include <linux/kernel.h>
 #include <linux/slab.h>
 #include <linux/types.h>
 #include <linux/string.h>
@@ -82,6 +83,16 @@ Polynom PolynomFromArray(int const *array, uint8_t array_size, uint8_t p) {
     return element;
 }
 
+Polynom PolynomFromCoefficients(uint8_t const *coefficients, uint8_t size, uint8_t p) {
+    Polynom element;
+    while (size > 1 && coefficients[size - 1] == 0) size--;
+    element = init(size, p);
+    if (element != NULL) {
+        memcpy(element->coefficients, coefficients, size);
+    }
+    return element;
+}
+
 Polynom CopyPolynom(Polynom elem) {
     Polynom res = init(elem->coeff_size, elem->p);
     if (res != NULL) {
@@ -155,6 +166,42 @@ Polynom MultPolynom(Polynom lhs, Polynom rhs) {
     return res;
 }
 
+Polynom DotPolynom(Polynom const *lhs, Polynom const *rhs, uint8_t n) {
+    size_t size = 1;
+    uint32_t *acc; // (p-1)^2 * 255 * 255 still fits
+    Polynom res;
+    if (n == 0) return NULL;
+    for (size_t i = 0; i < n; i++) {
+        if (lhs[i]->p != lhs[0]->p || rhs[i]->p != lhs[0]->p) return NULL;
+        size = MAX(size, lhs[i]->coeff_size + rhs[i]->coeff_size - 1);
+    }
+    if (size > U8_MAX) return NULL;
+
+    acc = (uint32_t *) kcalloc(size, sizeof(uint32_t), GFP_KERNEL);
+    if (acc == NULL) return NULL;
+    res = init(size, lhs[0]->p);
+    if (res == NULL) {
+        kfree(acc);
+        return NULL;
+    }
+    for (size_t i = 0; i < n; i++) {
+        for (int j = 0; j < lhs[i]->coeff_size; j++) {
+            for (int l = 0; l < rhs[i]->coeff_size; l++) {
+                acc[j + l] += lhs[i]->coefficients[j] * rhs[i]->coefficients[l];
+            }
+        }
+    }
+    for (size_t j = 0; j < size; j++) {
+        res->coefficients[j] = acc[j] % res->p;
+    }
+    kfree(acc);
+    if (!trim_zeroes(res)) {
+        kfree(res);
+        return NULL;
+    }
+    return res;
+}
+
 bool IsZeroPolynom(Polynom pol) {
     if (pol == NULL) return false;
     return pol->coeff_size == 1 && pol->coefficients[0] == 0;
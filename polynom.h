@@ -21,12 +21,18 @@ Polynom NegPolynom(Polynom elem);
 
 Polynom ModPolynom(Polynom lhs, Polynom rhs);
 
+// sum of lhs[i] * rhs[i], coefficients are reduced mod p once at the end
+Polynom DotPolynom(Polynom const *lhs, Polynom const *rhs, uint8_t n);
+
 Polynom IdentityPolynom(uint8_t p);
 
 Polynom ZeroPolynom(uint8_t p);
 
 Polynom PolynomFromArray(int const *array, uint8_t array_size, uint8_t p);
 
+// little - endian coefficients already reduced mod p, size >= 1; trailing zeroes are dropped
+Polynom PolynomFromCoefficients(uint8_t const *coefficients, uint8_t size, uint8_t p);
+
 Polynom CopyPolynom(Polynom elem);
 
 uint8_t PolynomDeg(Polynom elem);
@@ -0,0 +1,216 @@
+#include "tower.h"
+#include "binary_field_extension.h"
+#include <linux/kernel.h>
+#include <linux/slab.h>
+
+static const int base_modulus[] = {1, 1, 1, 1, 1, 1, 0, 0, 1}; // same as setup_generator()
+#define BASE_MODULUS 0x1F9
+
+static uint16_t mult16(struct TowerField const *t, uint16_t lhs, uint16_t rhs) {
+    struct Uint8Tables const *tables = t->base->tables;
+    uint8_t a0 = lhs, a1 = lhs >> 8, b0 = rhs, b1 = rhs >> 8;
+    uint8_t lo = MultUint8(tables, a0, b0);
+    uint8_t hi = MultUint8(tables, a1, b1);
+    uint8_t mid = MultUint8(tables, a0 ^ a1, b0 ^ b1);
+    // y^2 = y + nu
+    return (uint16_t) (mid ^ lo) << 8 | (lo ^ MultUint8(tables, hi, t->nu));
+}
+
+static uint16_t inv16(struct TowerField const *t, uint16_t elem) {
+    struct Uint8Tables const *tables = t->base->tables;
+    uint8_t a0 = elem, a1 = elem >> 8, norm, inv;
+    // (a1 y + a0)(a1 y + a0 + a1) = a0 (a0 + a1) + nu a1^2 is in GF(2^8)
+    norm = MultUint8(tables, a0, a0 ^ a1) ^ MultUint8(tables, t->nu, MultUint8(tables, a1, a1));
+    if (norm == 0) return 0;
+    inv = tables->exp[255 - tables->log[norm]];
+    return (uint16_t) MultUint8(tables, a1, inv) << 8 | MultUint8(tables, a0 ^ a1, inv);
+}
+
+uint32_t TowerMult(struct TowerField const *t, uint32_t lhs, uint32_t rhs) {
+    uint16_t a0 = lhs, a1 = lhs >> 16, b0 = rhs, b1 = rhs >> 16, lo, hi, mid;
+    if (t->levels == 1) return mult16(t, lhs, rhs);
+    lo = mult16(t, a0, b0);
+    hi = mult16(t, a1, b1);
+    mid = mult16(t, a0 ^ a1, b0 ^ b1);
+    // z^2 = z + mu
+    return (uint32_t) (mid ^ lo) << 16 | (lo ^ mult16(t, hi, t->mu));
+}
+
+uint32_t TowerInv(struct TowerField const *t, uint32_t elem) {
+    uint16_t a0 = elem, a1 = elem >> 16, norm, inv;
+    if (t->levels == 1) return inv16(t, elem);
+    norm = mult16(t, a0, a0 ^ a1) ^ mult16(t, t->mu, mult16(t, a1, a1));
+    inv = inv16(t, norm);
+    return (uint32_t) mult16(t, a1, inv) << 16 | mult16(t, a0 ^ a1, inv);
+}
+
+uint32_t ToTower(struct TowerField const *t, uint32_t binary) {
+    return t->to_tower[0][binary & 0xff] ^ t->to_tower[1][binary >> 8 & 0xff] ^
+           t->to_tower[2][binary >> 16 & 0xff] ^ t->to_tower[3][binary >> 24];
+}
+
+uint32_t FromTower(struct TowerField const *t, uint32_t tower) {
+    return t->from_tower[0][tower & 0xff] ^ t->from_tower[1][tower >> 8 & 0xff] ^
+           t->from_tower[2][tower >> 16 & 0xff] ^ t->from_tower[3][tower >> 24];
+}
+
+/* below only builds the basis change, in the polynomial basis of degree n */
+
+static uint32_t clmul_mod32(uint32_t lhs, uint32_t rhs, uint64_t modulus, uint8_t n) {
+    uint64_t res = 0;
+    uint64_t shifted = lhs;
+    while (rhs > 0) {
+        if (rhs & 1) {
+            res ^= shifted;
+        }
+        shifted <<= 1;
+        if (shifted & (1ull << n)) {
+            shifted ^= modulus;
+        }
+        rhs >>= 1;
+    }
+    return res;
+}
+
+static uint32_t pow_mod32(uint32_t base, uint64_t deg, uint64_t modulus, uint8_t n) {
+    uint32_t res = 1;
+    for (; deg > 0; deg >>= 1) {
+        if (deg & 1) res = clmul_mod32(res, base, modulus, n);
+        base = clmul_mod32(base, base, modulus, n);
+    }
+    return res;
+}
+
+/*
+ * A root of the GF(2^8) modulus. s^((2^n - 1) / 255) lies in the GF(2^8)
+ * inside, its powers cover all of it once s is primitive.
+ */
+static uint32_t base_root(uint64_t modulus, uint8_t n) {
+    uint64_t cofactor = ((1ull << n) - 1) / 255;
+    for (uint32_t s = 2; s < (1u << 16); s++) {
+        uint32_t h = pow_mod32(s, cofactor, modulus, n), v = h;
+        do {
+            uint32_t value = 0;
+            for (int i = 8; i >= 0; i--) value = clmul_mod32(value, v, modulus, n) ^ (BASE_MODULUS >> i & 1);
+            if (value == 0) return v;
+            v = clmul_mod32(v, h, modulus, n);
+        } while (v != h);
+    }
+    return 0;
+}
+
+// x with the sum of cols[j] over the set bits j of x equal to rhs, false if there is none
+static bool solve_gf2(uint32_t const *cols, uint8_t n, uint32_t rhs, uint32_t *x) {
+    uint64_t rows[32]; // bit j: coefficient of x_j, bit 32: right side
+    uint8_t pivots[32];
+    uint8_t rank = 0;
+
+    for (uint8_t i = 0; i < n; i++) {
+        rows[i] = (uint64_t) (rhs >> i & 1) << 32;
+        for (uint8_t j = 0; j < n; j++) rows[i] |= (uint64_t) (cols[j] >> i & 1) << j;
+    }
+    for (uint8_t col = 0; col < n && rank < n; col++) {
+        uint8_t r = rank;
+        uint64_t tmp;
+        while (r < n && !(rows[r] >> col & 1)) r++;
+        if (r == n) continue;
+        tmp = rows[r];
+        rows[r] = rows[rank];
+        rows[rank] = tmp;
+        for (uint8_t i = 0; i < n; i++) {
+            if (i != rank && (rows[i] >> col & 1)) rows[i] ^= rows[rank];
+        }
+        pivots[rank++] = col;
+    }
+    for (uint8_t i = rank; i < n; i++) {
+        if (rows[i] >> 32 & 1) return false;
+    }
+    *x = 0;
+    for (uint8_t i = 0; i < rank; i++) *x |= (uint32_t) (rows[i] >> 32 & 1) << pivots[i];
+    return true;
+}
+
+// sum of img[j] over the set bits j of value
+static uint32_t embed(uint32_t const *img, uint32_t value, uint8_t bits) {
+    uint32_t res = 0;
+    for (uint8_t j = 0; j < bits; j++) {
+        if (value >> j & 1) res ^= img[j];
+    }
+    return res;
+}
+
+static void fill_tables(uint32_t table[4][256], uint32_t const *img, uint8_t n) {
+    for (uint8_t k = 0; k < n / 8; k++) {
+        for (uint16_t v = 0; v < 256; v++) table[k][v] = embed(img + 8 * k, v, 8);
+    }
+}
+
+// z^2 + z + c is irreducible iff the absolute trace of c is one
+static uint16_t trace(struct TowerField const *t, uint16_t c, uint8_t bits) {
+    uint16_t sum = 0;
+    for (uint8_t i = 0; i < bits; i++) {
+        sum ^= c;
+        c = bits == 8 ? MultUint8(t->base->tables, c, c) : mult16(t, c, c);
+    }
+    return sum;
+}
+
+/*
+ * Images of the tower basis in the polynomial basis: powers of a root of the
+ * GF(2^8) modulus, then times y and z. y^2 + y = nu and z^2 + z = mu are
+ * linear over F_2, so y and z come from solving linear systems.
+ */
+static bool build_maps(struct TowerField *t, uint8_t n) {
+    Polynom pol = t->field->pol;
+    uint64_t modulus = 0;
+    uint32_t img[32], inv_img[32], square[32], root, y, z;
+
+    for (uint8_t i = 0; i < pol->coeff_size; i++) modulus |= (uint64_t) pol->coefficients[i] << i;
+    for (t->nu = 1; trace(t, t->nu, 8) != 1; t->nu++);
+    root = base_root(modulus, n);
+    if (root == 0) return false;
+    img[0] = 1;
+    for (uint8_t j = 1; j < 8; j++) img[j] = clmul_mod32(img[j - 1], root, modulus, n);
+
+    for (uint8_t j = 0; j < n; j++) square[j] = clmul_mod32(1u << j, 1u << j, modulus, n) ^ (1u << j);
+    if (!solve_gf2(square, n, embed(img, t->nu, 8), &y)) return false;
+    for (uint8_t j = 0; j < 8; j++) img[8 + j] = clmul_mod32(img[j], y, modulus, n);
+    if (n == 32) {
+        for (t->mu = 1; trace(t, t->mu, 16) != 1; t->mu++);
+        if (!solve_gf2(square, n, embed(img, t->mu, 16), &z)) return false;
+        for (uint8_t j = 0; j < 16; j++) img[16 + j] = clmul_mod32(img[j], z, modulus, n);
+    }
+
+    for (uint8_t i = 0; i < n; i++) {
+        if (!solve_gf2(img, n, 1u << i, &inv_img[i])) return false;
+    }
+    fill_tables(t->from_tower, img, n);
+    fill_tables(t->to_tower, inv_img, n);
+    return true;
+}
+
+struct TowerField *CreateTowerField(FiniteField f) {
+    struct TowerField *t;
+    uint8_t n;
+
+    if (f->p != 2) return NULL;
+    n = PolynomDeg(f->pol);
+    if (n != 16 && n != 32) return NULL;
+    t = (struct TowerField *) kzalloc(sizeof(struct TowerField), GFP_KERNEL);
+    if (t == NULL) return NULL;
+    t->field = HoldField(f);
+    t->base = CreateF_q(2, 8, base_modulus);
+    t->levels = n / 16;
+    if (t->base == NULL || t->base->tables == NULL || !build_maps(t, n)) {
+        FreeTowerField(t);
+        return NULL;
+    }
+    return t;
+}
+
+void FreeTowerField(struct TowerField *t) {
+    if (t == NULL) return;
+    if (t->base != NULL) FreeField(t->base);
+    FreeField(t->field);
+    kfree(t);
+}
@@ -0,0 +1,38 @@
+#ifndef FINITEFIELDSHW_TOWER_H
+#define FINITEFIELDSHW_TOWER_H
+
+#include <linux/types.h>
+#include "finite_field.h"
+
+/*
+ * GF(2^16) as GF(2^8)[y]/(y^2 + y + nu) and GF(2^32) as GF(2^16)[z]/(z^2 + z + mu),
+ * GF(2^8) with the generator's modulus and its log/exp tables. A tower element is
+ * hi * y + lo with the high half in the upper bits; addition is xor.
+ */
+struct TowerField {
+    FiniteField field;  // GF(2^16) or GF(2^32) in polynomial basis, held
+    FiniteField base;   // GF(2^8), held
+    uint8_t levels;     // 1 or 2
+    uint8_t nu;
+    uint16_t mu;
+    uint32_t to_tower[4][256];   // polynomial basis bytes, as in ToUint32, to tower
+    uint32_t from_tower[4][256];
+};
+
+// NULL if f is not GF(2^16) or GF(2^32)
+struct TowerField *CreateTowerField(FiniteField f);
+
+void FreeTowerField(struct TowerField *t);
+
+// basis change, xor of one table entry per byte
+uint32_t ToTower(struct TowerField const *t, uint32_t binary);
+
+uint32_t FromTower(struct TowerField const *t, uint32_t tower);
+
+// Karatsuba: 3 GF(2^8) multiplications per level
+uint32_t TowerMult(struct TowerField const *t, uint32_t lhs, uint32_t rhs);
+
+// zero for zero
+uint32_t TowerInv(struct TowerField const *t, uint32_t elem);
+
+#endif //FINITEFIELDSHW_TOWER_H
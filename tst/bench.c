@@ -0,0 +1,393 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <sys/ioctl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../chardriver_ioctl.h"
+
+/*
+ * gcc -O2 -pthread -o bench tst/bench.c
+ * ./bench [-d /dev/chardev] [-s 1,64,4096] [-k 2,16] [-r 1,4] [-m thread|fork|batch] [-n reads] [-c]
+ *
+ * For every (k, read size, readers) combination the device is seeded with k and
+ * each reader issues n reads. Reports aggregate MB/s and per-read latency percentiles.
+ *   thread - readers are threads sharing one fd
+ *   fork   - readers are processes sharing the inherited fd
+ *   batch  - readers are contexts of one fd, each read is one CHARDRIVER_IOC_CTX_FILL
+ *            filling a buffer from every context; latency is per batch
+ * -c prints CSV instead of a table. The driver allows one open fd at a time,
+ * so parallel readers always share it.
+ */
+
+#define MAX_LIST 32
+
+enum mode { MODE_THREAD, MODE_FORK, MODE_BATCH };
+static const char *mode_names[] = {"thread", "fork", "batch"};
+
+struct config {
+    const char *device;
+    size_t sizes[MAX_LIST];
+    int n_sizes;
+    int ks[MAX_LIST];
+    int n_ks;
+    int readers[MAX_LIST];
+    int n_readers;
+    enum mode mode;
+    int reads;
+    int csv;
+};
+
+/* общая для потоков и процессов память */
+struct shared {
+    int ready; // readers waiting at the start gate
+    int go;    // opens the gate, set once every started reader is ready
+    int failed;
+    uint64_t first_start;
+    uint64_t last_end;
+    uint64_t latencies[]; // readers * reads, ns
+};
+
+struct reader {
+    struct config const *cfg;
+    struct shared *shared;
+    int fd;
+    size_t size;
+    int index;
+};
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/* a positive number and nothing else, -1 otherwise */
+static long parse_positive(const char *arg)
+{
+    char *end;
+    long value;
+    errno = 0;
+    value = strtol(arg, &end, 0);
+    if (errno != 0 || end == arg || *end != '\0' || value <= 0) return -1;
+    return value;
+}
+
+/* comma separated positive numbers, -1 if any of them is not */
+static int parse_list(const char *arg, long *out)
+{
+    int n = 0;
+    char *copy = strdup(arg), *save = NULL;
+    if (copy == NULL) return -1;
+    for (char *tok = strtok_r(copy, ",", &save); tok != NULL && n < MAX_LIST; tok = strtok_r(NULL, ",", &save)) {
+        out[n] = parse_positive(tok);
+        if (out[n++] < 0) {
+            n = -1;
+            break;
+        }
+    }
+    free(copy);
+    return n;
+}
+
+/* k, a_0..a_k-1, x_0..x_k-1, c */
+static size_t make_seed(unsigned char *buff, int k, int stream)
+{
+    buff[0] = k;
+    for (int i = 0; i < k; i++) {
+        buff[1 + i] = 17 * i + 1;
+        buff[1 + k + i] = 31 * i + 5 + stream;
+    }
+    buff[2 * k + 1] = 8;
+    return 2 * k + 2;
+}
+
+static int seed(int fd, int k)
+{
+    unsigned char buff[2 * 255 + 2];
+    size_t len = make_seed(buff, k, 0);
+    return write(fd, buff, len) == (ssize_t) len ? 0 : -1;
+}
+
+/* creates and seeds a context per stream */
+static int seed_contexts(int fd, int k, struct chardriver_fill *fills, int n)
+{
+    unsigned char buff[2 * 255 + 2];
+    for (int i = 0; i < n; i++) {
+        struct chardriver_ctx_seed cs;
+        if (ioctl(fd, CHARDRIVER_IOC_CTX_CREATE, &fills[i].id) < 0) return -1;
+        cs = (struct chardriver_ctx_seed) {.id = fills[i].id, .len = make_seed(buff, k, i), .seed = (uintptr_t) buff};
+        if (ioctl(fd, CHARDRIVER_IOC_CTX_SEED, &cs) < 0) return -1;
+    }
+    return 0;
+}
+
+/* sign < 0 keeps the minimum, > 0 the maximum */
+static void update_bound(uint64_t *bound, uint64_t value, int sign)
+{
+    uint64_t cur = __atomic_load_n(bound, __ATOMIC_RELAXED);
+    while ((sign < 0 ? value < cur : value > cur) &&
+           !__atomic_compare_exchange_n(bound, &cur, value, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
+static void *run_reader(void *arg)
+{
+    struct reader *r = arg;
+    uint64_t *lat = r->shared->latencies + (size_t) r->index * r->cfg->reads;
+    unsigned char *buff = malloc(r->size);
+    int fd = r->fd;
+
+    if (buff == NULL) {
+        fprintf(stderr, "reader %d: out of memory\n", r->index);
+        __atomic_store_n(&r->shared->failed, 1, __ATOMIC_RELAXED);
+    }
+    /* ждём остальных, иначе первые читатели меряют без конкуренции */
+    __atomic_add_fetch(&r->shared->ready, 1, __ATOMIC_RELEASE);
+    while (!__atomic_load_n(&r->shared->go, __ATOMIC_ACQUIRE)) sched_yield();
+    update_bound(&r->shared->first_start, now_ns(), -1);
+
+    for (int i = 0; i < r->cfg->reads && !__atomic_load_n(&r->shared->failed, __ATOMIC_RELAXED); i++) {
+        uint64_t start = now_ns();
+        ssize_t n = read(fd, buff, r->size);
+        lat[i] = now_ns() - start;
+        if (n != (ssize_t) r->size) {
+            fprintf(stderr, "reader %d: short read %zd of %zu\n", r->index, n, r->size);
+            __atomic_store_n(&r->shared->failed, 1, __ATOMIC_RELAXED);
+        }
+    }
+
+    update_bound(&r->shared->last_end, now_ns(), 1);
+
+    free(buff);
+    return NULL;
+}
+
+static int cmp_u64(const void *lhs, const void *rhs)
+{
+    uint64_t a = *(const uint64_t *) lhs, b = *(const uint64_t *) rhs;
+    return a < b ? -1 : a > b;
+}
+
+static double percentile_us(uint64_t const *sorted, size_t n, double q)
+{
+    size_t i = (size_t) (q * (n - 1) + 0.5);
+    return sorted[i] / 1000.0;
+}
+
+static void report(struct config const *cfg, int k, size_t size, int readers,
+                   uint64_t *latencies, size_t n_lat, double bytes, uint64_t elapsed)
+{
+    double mbps = bytes / (elapsed / 1e9) / 1e6;
+    qsort(latencies, n_lat, sizeof(uint64_t), cmp_u64);
+    printf(cfg->csv ? "%s,%d,%zu,%d,%.3f,%.2f,%.2f,%.2f\n" : "%-7s %4d %9zu %7d %10.3f %10.2f %10.2f %10.2f\n",
+           mode_names[cfg->mode], k, size, readers, mbps,
+           percentile_us(latencies, n_lat, 0.5),
+           percentile_us(latencies, n_lat, 0.99),
+           percentile_us(latencies, n_lat, 0.999));
+    fflush(stdout);
+}
+
+/* один поток, один fd, все контексты за один ioctl */
+static int run_batch(struct config const *cfg, int k, size_t size, int contexts)
+{
+    struct chardriver_fill *fills;
+    uint64_t *latencies, start;
+    unsigned char *buff;
+    int fd = -1, failed = 1;
+
+    if (contexts > CHARDRIVER_MAX_BATCH) {
+        fprintf(stderr, "batch: at most %d contexts\n", CHARDRIVER_MAX_BATCH);
+        return -1;
+    }
+    fills = calloc(contexts, sizeof(*fills));
+    latencies = calloc(cfg->reads, sizeof(uint64_t));
+    buff = malloc(size * contexts);
+    if (fills == NULL || latencies == NULL || buff == NULL) {
+        perror("alloc");
+        goto out;
+    }
+    fd = open(cfg->device, O_RDWR);
+    if (fd == -1 || seed_contexts(fd, k, fills, contexts) < 0) {
+        fprintf(stderr, "%s: %s\n", cfg->device, strerror(errno));
+        goto out;
+    }
+    failed = 0;
+    for (int i = 0; i < contexts; i++) {
+        fills[i].buf = (uintptr_t) (buff + (size_t) i * size);
+        fills[i].len = size;
+    }
+
+    start = now_ns();
+    for (int i = 0; i < cfg->reads && !failed; i++) {
+        struct chardriver_batch batch = {.fills = (uintptr_t) fills, .count = contexts};
+        uint64_t t = now_ns();
+        if (ioctl(fd, CHARDRIVER_IOC_CTX_FILL, &batch) < 0 || batch.done != (uint32_t) contexts) {
+            fprintf(stderr, "batch: %s\n", strerror(errno));
+            failed = 1;
+        }
+        latencies[i] = now_ns() - t;
+        for (int j = 0; j < contexts && !failed; j++) {
+            if (fills[j].result != (int64_t) size) {
+                fprintf(stderr, "batch: context %u gave %lld of %zu\n", fills[j].id, (long long) fills[j].result, size);
+                failed = 1;
+            }
+        }
+    }
+    if (!failed) report(cfg, k, size, contexts, latencies, cfg->reads, (double) cfg->reads * contexts * size, now_ns() - start);
+
+out:
+    if (fd != -1) close(fd);
+    free(fills);
+    free(latencies);
+    free(buff);
+    return failed ? -1 : 0;
+}
+
+static int run_case(struct config const *cfg, int k, size_t size, int readers)
+{
+    size_t n_lat = (size_t) readers * cfg->reads;
+    size_t shared_size = sizeof(struct shared) + n_lat * sizeof(uint64_t);
+    struct shared *shared = mmap(NULL, shared_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    struct reader *rs = calloc(readers, sizeof(*rs));
+    pthread_t *threads = calloc(readers, sizeof(*threads));
+    uint64_t elapsed;
+    int fd = -1, failed, started;
+
+    if (shared == MAP_FAILED || rs == NULL || threads == NULL) {
+        perror("alloc");
+        exit(1);
+    }
+    memset(shared, 0, shared_size);
+    shared->first_start = UINT64_MAX;
+
+    fd = open(cfg->device, O_RDWR);
+    if (fd == -1 || seed(fd, k) < 0) {
+        fprintf(stderr, "%s: %s\n", cfg->device, strerror(errno));
+        exit(1);
+    }
+
+    for (started = 0; started < readers; started++) {
+        int err = 0;
+        pid_t pid;
+        rs[started] = (struct reader) {.cfg = cfg, .shared = shared, .fd = fd, .size = size, .index = started};
+        if (cfg->mode == MODE_THREAD) {
+            err = pthread_create(&threads[started], NULL, run_reader, &rs[started]);
+        } else if ((pid = fork()) == 0) {
+            run_reader(&rs[started]);
+            _exit(0);
+        } else if (pid == -1) {
+            err = errno;
+        }
+        if (err != 0) {
+            /* запущенные читатели увидят failed у ворот и выйдут */
+            fprintf(stderr, "reader %d: %s\n", started, strerror(err));
+            shared->failed = 1;
+            break;
+        }
+    }
+
+    while (__atomic_load_n(&shared->ready, __ATOMIC_ACQUIRE) < started) sched_yield();
+    __atomic_store_n(&shared->go, 1, __ATOMIC_RELEASE);
+    for (int i = 0; i < started; i++) {
+        if (cfg->mode == MODE_THREAD) {
+            pthread_join(threads[i], NULL);
+        } else {
+            wait(NULL);
+        }
+    }
+    /* от старта первого читателя до конца последнего */
+    elapsed = shared->last_end - shared->first_start;
+    failed = shared->failed;
+
+    if (!failed) report(cfg, k, size, readers, shared->latencies, n_lat, (double) n_lat * size, elapsed);
+
+    if (fd != -1) close(fd);
+    munmap(shared, shared_size);
+    free(rs);
+    free(threads);
+    return failed ? -1 : 0;
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr, "usage: %s [-d device] [-s sizes] [-k ks] [-r readers] [-m thread|fork|batch] [-n reads] [-c]\n", name);
+    exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    struct config cfg = {
+        .device = "/dev/chardev",
+        .sizes = {1, 64, 4096, 65536}, .n_sizes = 4,
+        .ks = {2, 16, 64}, .n_ks = 3,
+        .readers = {1, 2, 4}, .n_readers = 3,
+        .mode = MODE_THREAD,
+        .reads = 1000,
+    };
+    long list[MAX_LIST];
+    int opt, failures = 0;
+
+    while ((opt = getopt(argc, argv, "d:s:k:r:m:n:c")) != -1) {
+        switch (opt) {
+            case 'd':
+                cfg.device = optarg;
+                break;
+            case 's':
+                cfg.n_sizes = parse_list(optarg, list);
+                if (cfg.n_sizes < 1) usage(argv[0]);
+                for (int i = 0; i < cfg.n_sizes; i++) cfg.sizes[i] = list[i];
+                break;
+            case 'k':
+                cfg.n_ks = parse_list(optarg, list);
+                if (cfg.n_ks < 1) usage(argv[0]);
+                for (int i = 0; i < cfg.n_ks; i++) {
+                    if (list[i] < 1 || list[i] > 255) usage(argv[0]);
+                    cfg.ks[i] = list[i];
+                }
+                break;
+            case 'r':
+                cfg.n_readers = parse_list(optarg, list);
+                if (cfg.n_readers < 1) usage(argv[0]);
+                for (int i = 0; i < cfg.n_readers; i++) cfg.readers[i] = list[i];
+                break;
+            case 'm':
+                if (strcmp(optarg, "thread") == 0) cfg.mode = MODE_THREAD;
+                else if (strcmp(optarg, "fork") == 0) cfg.mode = MODE_FORK;
+                else if (strcmp(optarg, "batch") == 0) cfg.mode = MODE_BATCH;
+                else usage(argv[0]);
+                break;
+            case 'n':
+                cfg.reads = parse_positive(optarg);
+                break;
+            case 'c':
+                cfg.csv = 1;
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+    if (cfg.reads < 1) usage(argv[0]);
+
+    printf(cfg.csv ? "mode,k,size,readers,mb_per_s,p50_us,p99_us,p999_us\n"
+                   : "mode       k      size readers       MB/s    p50(us)    p99(us)   p999(us)\n");
+    for (int ki = 0; ki < cfg.n_ks; ki++) {
+        for (int si = 0; si < cfg.n_sizes; si++) {
+            for (int ri = 0; ri < cfg.n_readers; ri++) {
+                int res = cfg.mode == MODE_BATCH ? run_batch(&cfg, cfg.ks[ki], cfg.sizes[si], cfg.readers[ri])
+                                                 : run_case(&cfg, cfg.ks[ki], cfg.sizes[si], cfg.readers[ri]);
+                if (res < 0) failures++;
+            }
+        }
+    }
+    return failures ? 1 : 0;
+}
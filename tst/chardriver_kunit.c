@@ -0,0 +1,1322 @@
+#include <kunit/test.h>
+#include <linux/ktime.h>
+#include <linux/slab.h>
+
+#include "../chardriver.h"
+#include "../finite_fields.h"
+#include "../generator.h"
+
+/*
+ * KUnit suite for the field library and the generator, no device needed.
+ *
+ * cp -r . <linux>/drivers/char/chardriver
+ * echo 'source "drivers/char/chardriver/Kconfig"' >> <linux>/drivers/char/Kconfig
+ * echo 'obj-y += chardriver/' >> <linux>/drivers/char/Makefile
+ * ./tools/testing/kunit/kunit.py run --kunitconfig=drivers/char/chardriver
+ *
+ * Out of tree: make CONFIG_CHARDRIVER_KUNIT_TEST=y, results show up in dmesg on insmod.
+ */
+
+static const int gf256_modulus[] = {1, 1, 1, 1, 1, 1, 0, 0, 1}; // same as setup_generator()
+
+#define BENCH_ITERATIONS 10000
+
+static FiniteField gf256(struct kunit *test)
+{
+    FiniteField f = CreateF_q(2, 8, gf256_modulus);
+    KUNIT_ASSERT_NOT_NULL(test, f);
+    return f;
+}
+
+static FieldElement byte(struct kunit *test, FiniteField f, uint8_t value)
+{
+    FieldElement elem = FromUint8(f, value);
+    KUNIT_ASSERT_NOT_NULL(test, elem);
+    return elem;
+}
+
+/* проверяет результат и освобождает его */
+static void expect_uint8(struct kunit *test, FieldElement elem, uint8_t expected)
+{
+    KUNIT_ASSERT_NOT_NULL(test, elem);
+    KUNIT_EXPECT_EQ(test, ToUint8(elem), expected);
+    FreeElement(elem);
+}
+
+static void polynom_arithmetic_test(struct kunit *test)
+{
+    const int lhs_coeffs[] = {1, 1}; // x + 1
+    const int rhs_coeffs[] = {2, 1}; // 2x + 1
+    const int mod_coeffs[] = {1, 2}; // x + 2
+    Polynom lhs = PolynomFromArray(lhs_coeffs, 2, 3);
+    Polynom rhs = PolynomFromArray(rhs_coeffs, 2, 3);
+    Polynom m = PolynomFromArray(mod_coeffs, 2, 3);
+    Polynom res;
+
+    KUNIT_ASSERT_NOT_NULL(test, lhs);
+    KUNIT_ASSERT_NOT_NULL(test, rhs);
+    KUNIT_ASSERT_NOT_NULL(test, m);
+    KUNIT_EXPECT_EQ(test, PolynomDeg(lhs), 1);
+
+    res = AddPolynom(lhs, rhs); // 3x + 2 = 2 over F_3
+    KUNIT_ASSERT_NOT_NULL(test, res);
+    KUNIT_EXPECT_EQ(test, PolynomDeg(res), 0);
+    KUNIT_EXPECT_EQ(test, res->coefficients[0], 2);
+    FreePolynom(res);
+
+    res = SubPolynom(lhs, lhs);
+    KUNIT_EXPECT_TRUE(test, IsZeroPolynom(res));
+    FreePolynom(res);
+
+    res = MultPolynom(lhs, rhs); // 2x^2 + 3x + 1 = 2x^2 + 1
+    KUNIT_ASSERT_NOT_NULL(test, res);
+    KUNIT_EXPECT_EQ(test, PolynomDeg(res), 2);
+    KUNIT_EXPECT_EQ(test, res->coefficients[0], 1);
+    KUNIT_EXPECT_EQ(test, res->coefficients[1], 0);
+    KUNIT_EXPECT_EQ(test, res->coefficients[2], 2);
+    FreePolynom(res);
+
+    res = NegPolynom(lhs); // 2x + 2
+    KUNIT_ASSERT_NOT_NULL(test, res);
+    KUNIT_EXPECT_EQ(test, res->coefficients[0], 2);
+    KUNIT_EXPECT_EQ(test, res->coefficients[1], 2);
+    FreePolynom(res);
+
+    res = ModPolynom(lhs, m); // (x + 1) - (x + 2) = -1 = 2
+    KUNIT_ASSERT_NOT_NULL(test, res);
+    KUNIT_EXPECT_EQ(test, PolynomDeg(res), 0);
+    KUNIT_EXPECT_EQ(test, res->coefficients[0], 2);
+    FreePolynom(res);
+
+    FreePolynom(lhs);
+    FreePolynom(rhs);
+    FreePolynom(m);
+}
+
+static void polynom_error_test(struct kunit *test)
+{
+    const int coeffs[] = {1, 1};
+    Polynom over_2 = PolynomFromArray(coeffs, 2, 2);
+    Polynom over_3 = PolynomFromArray(coeffs, 2, 3);
+    Polynom zero = ZeroPolynom(2);
+
+    KUNIT_EXPECT_NULL(test, AddPolynom(over_2, over_3));
+    KUNIT_EXPECT_NULL(test, MultPolynom(over_2, over_3));
+    KUNIT_EXPECT_NULL(test, ModPolynom(over_2, zero));
+    KUNIT_EXPECT_TRUE(test, IsZeroPolynom(zero));
+    KUNIT_EXPECT_FALSE(test, IsIdentityPolynom(zero));
+
+    FreePolynom(over_2);
+    FreePolynom(over_3);
+    FreePolynom(zero);
+}
+
+static void finite_field_equality_test(struct kunit *test)
+{
+    const int other_modulus[] = {1, 0, 0, 0, 1, 1, 0, 1, 1}; // x^8 + x^4 + x^3 + x + 1
+    FiniteField f = gf256(test);
+    FiniteField same = gf256(test);
+    FiniteField other = CreateF_q(2, 8, other_modulus);
+    FiniteField f5 = CreateF_p(5);
+    FiniteField f7 = CreateF_p(7);
+
+    KUNIT_EXPECT_TRUE(test, AreEqualFields(f, f));
+    KUNIT_EXPECT_TRUE(test, AreEqualFields(f, same));
+    KUNIT_EXPECT_PTR_EQ(test, f, same); // interned
+    KUNIT_EXPECT_NOT_NULL(test, f->tables);
+    KUNIT_EXPECT_NULL(test, f5->tables);
+    KUNIT_EXPECT_FALSE(test, AreEqualFields(f, other));
+    KUNIT_EXPECT_FALSE(test, AreEqualFields(f5, f7));
+
+    FreeField(f);
+    FreeField(same);
+    FreeField(other);
+    FreeField(f5);
+    FreeField(f7);
+}
+
+static void finite_field_lifetime_test(struct kunit *test)
+{
+    const int gf2_16[] = {1, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 1};
+    FiniteField f = CreateF_q(2, 16, gf2_16);
+    FieldElement a, b, c;
+    struct FixedBase *fb;
+
+    KUNIT_ASSERT_NOT_NULL(test, f);
+    a = FromUint16(f, 0x1234);
+    KUNIT_ASSERT_NOT_NULL(test, a);
+    fb = CreateFixedBase(a);
+    KUNIT_ASSERT_NOT_NULL(test, fb);
+    FreeElement(a);
+    FreeField(f); // elements only borrow it, the FixedBase keeps the field alive
+    b = FixedBasePow(fb, 3);
+    KUNIT_ASSERT_NOT_NULL(test, b);
+    KUNIT_EXPECT_PTR_EQ(test, b->field, fb->field);
+
+    f = CreateF_q(2, 16, gf2_16); // still registered, same descriptor
+    KUNIT_EXPECT_PTR_EQ(test, f, fb->field);
+    a = FromUint16(f, 0x1234);
+    KUNIT_ASSERT_NOT_NULL(test, a);
+    c = Pow(a, 3);
+    KUNIT_ASSERT_NOT_NULL(test, c);
+    KUNIT_EXPECT_EQ(test, ToUint16(b), ToUint16(c));
+    FreeElement(a);
+    FreeElement(b);
+    FreeElement(c);
+    FreeFixedBase(fb);
+    FreeField(f);
+}
+
+static void field_element_axioms_test(struct kunit *test)
+{
+    FiniteField f = gf256(test);
+    FieldElement zero = GetZero(f);
+    FieldElement one = GetIdentity(f);
+
+    KUNIT_ASSERT_NOT_NULL(test, zero);
+    KUNIT_ASSERT_NOT_NULL(test, one);
+
+    for (int i = 0; i < 256; i++) {
+        FieldElement a = byte(test, f, i);
+        FieldElement b = byte(test, f, (i * 37 + 11) & 0xff);
+        FieldElement c = byte(test, f, (i * 101 + 5) & 0xff);
+        FieldElement lhs, rhs, ab, ac, bc;
+
+        expect_uint8(test, Add(a, zero), i);
+        expect_uint8(test, Mult(a, one), i);
+        expect_uint8(test, Add(a, a), 0); // characteristic 2
+        expect_uint8(test, Sub(a, b), ToUint8(b) ^ i);
+
+        ab = Mult(a, b);
+        lhs = Mult(b, a);
+        KUNIT_EXPECT_TRUE(test, AreEqual(ab, lhs));
+        FreeElement(lhs);
+
+        bc = Mult(b, c);
+        lhs = Mult(ab, c);
+        rhs = Mult(a, bc);
+        KUNIT_EXPECT_TRUE(test, AreEqual(lhs, rhs));
+        FreeElement(lhs);
+        FreeElement(rhs);
+        FreeElement(bc);
+
+        bc = Add(b, c);
+        ac = Mult(a, c);
+        lhs = Mult(a, bc);
+        rhs = Add(ab, ac);
+        KUNIT_EXPECT_TRUE(test, AreEqual(lhs, rhs));
+        FreeElement(lhs);
+        FreeElement(rhs);
+        FreeElement(bc);
+        FreeElement(ac);
+        FreeElement(ab);
+
+        if (i != 0) {
+            FieldElement inv = Inv(a);
+            KUNIT_ASSERT_NOT_NULL(test, inv);
+            lhs = Mult(a, inv);
+            KUNIT_EXPECT_TRUE(test, IsIdentity(lhs));
+            FreeElement(lhs);
+            lhs = Division(b, a);
+            rhs = Mult(b, inv);
+            KUNIT_EXPECT_TRUE(test, AreEqual(lhs, rhs));
+            FreeElement(lhs);
+            FreeElement(rhs);
+            FreeElement(inv);
+            lhs = Pow(a, 255); // мультипликативная группа порядка 255
+            KUNIT_EXPECT_TRUE(test, IsIdentity(lhs));
+            FreeElement(lhs);
+        }
+
+        FreeElement(a);
+        FreeElement(b);
+        FreeElement(c);
+    }
+
+    FreeElement(zero);
+    FreeElement(one);
+    FreeField(f);
+}
+
+static void field_element_prime_field_test(struct kunit *test)
+{
+    FiniteField f = CreateF_p(7);
+    KUNIT_ASSERT_NOT_NULL(test, f);
+
+    for (int i = 1; i < 7; i++) {
+        const int value[] = {i};
+        FieldElement a = GetFromArray(f, value, 1);
+        FieldElement inv = Inv(a);
+        FieldElement prod = Mult(a, inv);
+        FieldElement neg = Neg(a);
+        FieldElement sum = Add(a, neg);
+
+        KUNIT_EXPECT_TRUE(test, IsIdentity(prod));
+        KUNIT_EXPECT_TRUE(test, IsZero(sum));
+
+        FreeElement(a);
+        FreeElement(inv);
+        FreeElement(prod);
+        FreeElement(neg);
+        FreeElement(sum);
+    }
+    FreeField(f);
+}
+
+static void field_element_error_test(struct kunit *test)
+{
+    FiniteField f = gf256(test);
+    FiniteField f7 = CreateF_p(7);
+    FieldElement a = byte(test, f, 3);
+    FieldElement zero = GetZero(f);
+    FieldElement b = GetIdentity(f7);
+
+    KUNIT_EXPECT_NULL(test, Add(a, b));
+    KUNIT_EXPECT_NULL(test, Mult(a, b));
+    KUNIT_EXPECT_FALSE(test, AreEqual(a, b));
+    KUNIT_EXPECT_NULL(test, Inv(zero));
+    KUNIT_EXPECT_NULL(test, Division(a, zero));
+
+    FreeElement(a);
+    FreeElement(zero);
+    FreeElement(b);
+    FreeField(f);
+    FreeField(f7);
+}
+
+static void field_element_dot_product_test(struct kunit *test)
+{
+    FiniteField f = gf256(test);
+    FiniteField f7 = CreateF_p(7);
+    FieldElement lhs[16], rhs[16], other[1];
+    FieldElement expected = GetZero(f);
+
+    KUNIT_ASSERT_NOT_NULL(test, expected);
+    for (int i = 0; i < 16; i++) {
+        FieldElement prod, sum;
+        lhs[i] = byte(test, f, 0xf0 + i);
+        rhs[i] = byte(test, f, 37 * i + 1);
+        prod = Mult(lhs[i], rhs[i]);
+        sum = Add(expected, prod);
+        FreeElement(prod);
+        FreeElement(expected);
+        expected = sum;
+    }
+    KUNIT_ASSERT_NOT_NULL(test, expected);
+
+    for (int n = 1; n <= 16; n += 15) {
+        FieldElement res = DotProduct(lhs, rhs, n);
+        KUNIT_ASSERT_NOT_NULL(test, res);
+        if (n == 16) KUNIT_EXPECT_TRUE(test, AreEqual(res, expected));
+        else expect_uint8(test, Mult(lhs[0], rhs[0]), ToUint8(res));
+        FreeElement(res);
+    }
+
+    other[0] = GetIdentity(f7);
+    KUNIT_EXPECT_NULL(test, DotProduct(lhs, other, 1));
+    KUNIT_EXPECT_NULL(test, DotProduct(lhs, rhs, 0));
+
+    for (int i = 0; i < 16; i++) {
+        FreeElement(lhs[i]);
+        FreeElement(rhs[i]);
+    }
+    FreeElement(other[0]);
+    FreeElement(expected);
+    FreeField(f);
+    FreeField(f7);
+}
+
+/* Pow against repeated Mult, for every exponentiation path */
+static void expect_pow(struct kunit *test, FieldElement a)
+{
+    FieldElement naive = GetIdentity(a->field);
+    struct FixedBase *fb = CreateFixedBase(a);
+    FieldElement res, inv, lhs, rhs;
+
+    KUNIT_ASSERT_NOT_NULL(test, fb);
+    for (int e = 0; e <= 40; e++) {
+        KUNIT_ASSERT_NOT_NULL(test, naive);
+        res = Pow(a, e);
+        KUNIT_EXPECT_TRUE(test, AreEqual(res, naive));
+        FreeElement(res);
+        res = FixedBasePow(fb, e);
+        KUNIT_EXPECT_TRUE(test, AreEqual(res, naive));
+        FreeElement(res);
+        res = naive;
+        naive = Mult(naive, a);
+        FreeElement(res);
+    }
+    FreeElement(naive);
+
+    // a^(e1 + e2) = a^e1 * a^e2 for exponents spanning several windows
+    for (int e = 1000; e < INT_MAX / 8; e = e * 7 + 13) {
+        res = Pow(a, e);
+        lhs = Pow(a, e / 3);
+        rhs = Pow(a, e - e / 3);
+        naive = Mult(lhs, rhs);
+        KUNIT_EXPECT_TRUE(test, AreEqual(res, naive));
+        FreeElement(naive);
+        naive = FixedBasePow(fb, e);
+        KUNIT_EXPECT_TRUE(test, AreEqual(res, naive));
+        FreeElement(naive);
+        FreeElement(lhs);
+        FreeElement(rhs);
+
+        // a^(-e) * a^e = 1
+        lhs = Pow(a, -e);
+        naive = Mult(lhs, res);
+        KUNIT_EXPECT_TRUE(test, IsIdentity(naive));
+        FreeElement(naive);
+        naive = FixedBasePow(fb, -e);
+        KUNIT_EXPECT_TRUE(test, AreEqual(lhs, naive));
+        FreeElement(naive);
+        FreeElement(lhs);
+        FreeElement(res);
+    }
+
+    inv = Inv(a);
+    res = Mult(a, inv);
+    KUNIT_EXPECT_TRUE(test, IsIdentity(res));
+    FreeElement(res);
+    FreeElement(inv);
+    if (a->field->order < INT_MAX) {
+        res = Pow(a, a->field->order + 1); // a^q = a
+        KUNIT_EXPECT_TRUE(test, AreEqual(res, a));
+        FreeElement(res);
+    }
+    FreeFixedBase(fb);
+}
+
+static void field_element_pow_test(struct kunit *test)
+{
+    const int gf2_16[] = {1, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 1}; // x^16 + x^12 + x^3 + x + 1
+    const int gf3_5[] = {1, 0, 0, 0, 2, 1}; // x^5 + 2x + 1
+    int gf2_33[34] = {0}; // x^33 + x^13 + 1, q - 1 does not fit 32 bits
+    const int value[] = {2, 1, 0, 1, 1};
+    const int generator_251[] = {6};
+    FiniteField fields[5];
+
+    gf2_33[0] = gf2_33[20] = gf2_33[33] = 1;
+    fields[0] = gf256(test);
+    fields[1] = CreateF_q(2, 16, gf2_16);
+    fields[2] = CreateF_q(3, 5, gf3_5);
+    fields[3] = CreateF_p(251);
+    fields[4] = CreateF_q(2, 33, gf2_33);
+    for (int i = 0; i < 5; i++) {
+        FieldElement a, zero, res;
+        KUNIT_ASSERT_NOT_NULL(test, fields[i]);
+        // in F_251 value would reduce to 1, 6 generates the whole group
+        a = i == 3 ? GetFromArray(fields[i], generator_251, 1) : GetFromArray(fields[i], value, 5);
+        KUNIT_ASSERT_NOT_NULL(test, a);
+        expect_pow(test, a);
+
+        zero = GetZero(fields[i]);
+        res = Pow(zero, 0);
+        KUNIT_EXPECT_TRUE(test, IsIdentity(res));
+        FreeElement(res);
+        res = Pow(zero, 12345);
+        KUNIT_EXPECT_TRUE(test, IsZero(res));
+        FreeElement(res);
+        KUNIT_EXPECT_NULL(test, Pow(zero, -1));
+
+        FreeElement(zero);
+        FreeElement(a);
+        FreeField(fields[i]);
+    }
+}
+
+static void binary_field_extension_test(struct kunit *test)
+{
+    const int reducible[] = {1, 0, 0, 0, 0, 0, 0, 0, 1}; // x^8 + 1 = (x + 1)^8
+    FiniteField f = gf256(test);
+    FiniteField bad = CreateF_q(2, 8, reducible);
+    FiniteField f3 = CreateF_p(3);
+    struct Uint8Tables *tables = CreateUint8Tables(f);
+
+    KUNIT_ASSERT_NOT_NULL(test, tables);
+    KUNIT_EXPECT_NULL(test, CreateUint8Tables(bad));
+    KUNIT_EXPECT_NULL(test, CreateUint8Tables(f3));
+
+    for (int i = 0; i < 256; i++) {
+        FieldElement a = byte(test, f, i);
+        KUNIT_EXPECT_EQ(test, ToUint8(a), i);
+        KUNIT_EXPECT_EQ(test, ToUint16(a), i);
+        KUNIT_EXPECT_EQ(test, ToUint32(a), i);
+        for (int j = 0; j < 256; j += 17) {
+            FieldElement b = byte(test, f, j);
+            expect_uint8(test, Mult(a, b), MultUint8(tables, i, j));
+            FreeElement(b);
+        }
+        FreeElement(a);
+    }
+
+    FreeUint8Tables(tables);
+    FreeField(f);
+    FreeField(bad);
+    FreeField(f3);
+}
+
+/* f(x) through Mult and Add, one allocation per step */
+static FieldElement naive_value(struct kunit *test, Polynom f, FieldElement x)
+{
+    FieldElement res = GetZero(x->field);
+    for (int i = f->coeff_size - 1; i >= 0; i--) {
+        int c = f->coefficients[i];
+        FieldElement coeff = GetFromArray(x->field, &c, 1);
+        FieldElement prod = Mult(res, x);
+        KUNIT_ASSERT_NOT_NULL(test, coeff);
+        KUNIT_ASSERT_NOT_NULL(test, prod);
+        FreeElement(res);
+        res = Add(prod, coeff);
+        FreeElement(prod);
+        FreeElement(coeff);
+    }
+    KUNIT_ASSERT_NOT_NULL(test, res);
+    return res;
+}
+
+static void evaluation_test(struct kunit *test)
+{
+    const int gf2_16[] = {1, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 1};
+    const int gf3_5[] = {1, 0, 0, 0, 2, 1};
+    const int coeffs[] = {1, 0, 2, 1, 1, 0, 0, 1, 2, 1, 0, 1};
+    const size_t counts[] = {7, 300}; // 300 is more than GF(3^5) and F_251 have elements
+    FiniteField fields[] = {gf256(test), CreateF_q(2, 16, gf2_16), CreateF_q(3, 5, gf3_5), CreateF_p(251)};
+    uint8_t bytes[300], values[300];
+    Polynom f;
+
+    for (int i = 0; i < 4; i++) {
+        KUNIT_ASSERT_NOT_NULL(test, fields[i]);
+        f = PolynomFromArray(coeffs, 12, fields[i]->p);
+        KUNIT_ASSERT_NOT_NULL(test, f);
+        for (int c = 0; c < 2; c++) {
+            size_t n = counts[c];
+            FieldElement *points = kcalloc(n, sizeof(FieldElement), GFP_KERNEL);
+            FieldElement *res;
+            KUNIT_ASSERT_NOT_NULL(test, points);
+            for (size_t j = 0; j < n; j++) {
+                const int value[] = {j % 3, j / 3 % 5, j * 7 % 11, j / 7, j * 13 + 1};
+                points[j] = GetFromArray(fields[i], value, 5);
+                KUNIT_ASSERT_NOT_NULL(test, points[j]);
+            }
+            res = EvaluatePolynom(f, points, n);
+            KUNIT_ASSERT_NOT_NULL(test, res);
+            for (size_t j = 0; j < n; j++) {
+                FieldElement expected = naive_value(test, f, points[j]);
+                KUNIT_EXPECT_TRUE(test, AreEqual(res[j], expected));
+                FreeElement(expected);
+            }
+            FreeValues(res, n);
+            FreeValues(points, n);
+        }
+        FreePolynom(f);
+    }
+
+    // bytes, with and without evaluating the whole field first
+    f = PolynomFromArray(coeffs, 12, 2);
+    KUNIT_ASSERT_NOT_NULL(test, f);
+    for (int j = 0; j < 300; j++) bytes[j] = j * 29 + 3;
+    KUNIT_ASSERT_EQ(test, EvaluatePolynomUint8(f, fields[0], bytes, values, 300), 0);
+    KUNIT_ASSERT_EQ(test, EvaluatePolynomUint8(f, fields[0], bytes + 50, values + 50, 7), 0);
+    for (int j = 0; j < 300; j++) {
+        FieldElement x = byte(test, fields[0], bytes[j]);
+        expect_uint8(test, naive_value(test, f, x), values[j]);
+        FreeElement(x);
+    }
+
+    // polynom over another F_p, field without tables
+    KUNIT_EXPECT_EQ(test, EvaluatePolynomUint8(f, fields[1], bytes, values, 7), -1);
+    FreePolynom(f);
+    f = PolynomFromArray(coeffs, 12, 3);
+    KUNIT_ASSERT_NOT_NULL(test, f);
+    KUNIT_EXPECT_EQ(test, EvaluatePolynomUint8(f, fields[0], bytes, values, 7), -1);
+    FreePolynom(f);
+
+    for (int i = 0; i < 4; i++) FreeField(fields[i]);
+}
+
+/* entries from a fixed LCG, written straight into the packed layout */
+static void fill_matrix(Matrix a, uint32_t seed)
+{
+    size_t size = (size_t) a->rows * a->cols * a->elem_size;
+    for (size_t i = 0; i < size; i++) {
+        seed = seed * 1103515245 + 12345;
+        a->data[i] = a->field->tables != NULL ? (seed >> 16) & a->field->order : (seed >> 16) % a->field->p;
+    }
+}
+
+static Matrix naive_product(struct kunit *test, Matrix lhs, Matrix rhs)
+{
+    Matrix res = CreateMatrix(lhs->field, lhs->rows, rhs->cols);
+    KUNIT_ASSERT_NOT_NULL(test, res);
+    for (uint32_t i = 0; i < lhs->rows; i++) {
+        for (uint32_t j = 0; j < rhs->cols; j++) {
+            FieldElement sum = GetZero(lhs->field);
+            for (uint32_t k = 0; k < lhs->cols; k++) {
+                FieldElement x = GetMatrixElement(lhs, i, k);
+                FieldElement y = GetMatrixElement(rhs, k, j);
+                FieldElement prod, tmp;
+                KUNIT_ASSERT_NOT_NULL(test, x);
+                KUNIT_ASSERT_NOT_NULL(test, y);
+                prod = Mult(x, y);
+                tmp = Add(sum, prod);
+                FreeElement(x);
+                FreeElement(y);
+                FreeElement(prod);
+                FreeElement(sum);
+                sum = tmp;
+                KUNIT_ASSERT_NOT_NULL(test, sum);
+            }
+            KUNIT_ASSERT_EQ(test, SetMatrixElement(res, i, j, sum), 0);
+            FreeElement(sum);
+        }
+    }
+    return res;
+}
+
+/* leading ones in increasing columns, alone in their column, zero rows last */
+static void expect_echelon(struct kunit *test, Matrix a, uint32_t rank)
+{
+    uint32_t col = 0;
+    for (uint32_t r = 0; r < a->rows; r++) {
+        FieldElement x = NULL;
+        while (col < a->cols) {
+            x = GetMatrixElement(a, r, col);
+            KUNIT_ASSERT_NOT_NULL(test, x);
+            if (!IsZero(x)) break;
+            FreeElement(x);
+            x = NULL;
+            col++;
+        }
+        KUNIT_EXPECT_EQ(test, x != NULL, r < rank);
+        if (x == NULL) continue;
+        KUNIT_EXPECT_TRUE(test, IsIdentity(x));
+        FreeElement(x);
+        for (uint32_t i = 0; i < a->rows; i++) {
+            x = GetMatrixElement(a, i, col);
+            KUNIT_EXPECT_EQ(test, IsZero(x), i != r);
+            FreeElement(x);
+        }
+        col++;
+    }
+}
+
+static void matrix_test(struct kunit *test)
+{
+    const int gf2_16[] = {1, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 1};
+    const int gf3_5[] = {1, 0, 0, 0, 2, 1};
+    int gf2_33[34] = {0}; // x^33 + x^13 + 1, bit masks wider than 32 bits
+    const uint32_t shapes[][3] = {{5, 7, 6}, {3, 70, 260}}; // the second crosses both block sizes
+    FiniteField fields[5];
+    Matrix a, b, c, d, e;
+    FieldElement x;
+
+    gf2_33[0] = gf2_33[20] = gf2_33[33] = 1;
+    fields[0] = gf256(test);
+    fields[1] = CreateF_q(2, 16, gf2_16);
+    fields[2] = CreateF_q(3, 5, gf3_5);
+    fields[3] = CreateF_p(251);
+    fields[4] = CreateF_q(2, 33, gf2_33);
+    for (int i = 0; i < 5; i++) {
+        KUNIT_ASSERT_NOT_NULL(test, fields[i]);
+        for (int s = 0; s < 2; s++) {
+            a = CreateMatrix(fields[i], shapes[s][0], shapes[s][1]);
+            b = CreateMatrix(fields[i], shapes[s][1], shapes[s][2]);
+            KUNIT_ASSERT_NOT_NULL(test, a);
+            KUNIT_ASSERT_NOT_NULL(test, b);
+            fill_matrix(a, i * 2 + s);
+            fill_matrix(b, i * 2 + s + 100);
+            c = MultMatrix(a, b);
+            KUNIT_ASSERT_NOT_NULL(test, c);
+            d = naive_product(test, a, b);
+            KUNIT_EXPECT_TRUE(test, AreEqualMatrices(c, d));
+            FreeMatrix(a);
+            FreeMatrix(b);
+            FreeMatrix(c);
+            FreeMatrix(d);
+        }
+
+        a = CreateMatrix(fields[i], 20, 20);
+        e = IdentityMatrix(fields[i], 20);
+        KUNIT_ASSERT_NOT_NULL(test, a);
+        KUNIT_ASSERT_NOT_NULL(test, e);
+        fill_matrix(a, i + 7);
+        KUNIT_ASSERT_EQ(test, MatrixRank(a), 20);
+        b = InverseMatrix(a);
+        KUNIT_ASSERT_NOT_NULL(test, b);
+        c = MultMatrix(a, b);
+        d = MultMatrix(b, a);
+        KUNIT_EXPECT_TRUE(test, AreEqualMatrices(c, e));
+        KUNIT_EXPECT_TRUE(test, AreEqualMatrices(d, e));
+        FreeMatrix(c);
+        FreeMatrix(d);
+
+        // a^5 against repeated products, a^0 = E, a^-3 * a^3 = E
+        c = PowMatrix(a, 5);
+        d = CopyMatrix(a);
+        KUNIT_ASSERT_NOT_NULL(test, c);
+        for (int k = 1; k < 5; k++) {
+            Matrix tmp = MultMatrix(d, a);
+            FreeMatrix(d);
+            d = tmp;
+            KUNIT_ASSERT_NOT_NULL(test, d);
+        }
+        KUNIT_EXPECT_TRUE(test, AreEqualMatrices(c, d));
+        FreeMatrix(c);
+        FreeMatrix(d);
+        c = PowMatrix(a, 0);
+        KUNIT_EXPECT_TRUE(test, AreEqualMatrices(c, e));
+        FreeMatrix(c);
+        c = PowMatrix(b, 3);
+        d = PowMatrix(a, 3);
+        KUNIT_ASSERT_NOT_NULL(test, c);
+        KUNIT_ASSERT_NOT_NULL(test, d);
+        FreeMatrix(b);
+        b = MultMatrix(c, d);
+        KUNIT_EXPECT_TRUE(test, AreEqualMatrices(b, e));
+        FreeMatrix(b);
+        FreeMatrix(c);
+        FreeMatrix(d);
+
+        // a repeated row: rank 19, no inverse, one zero row after elimination
+        memcpy(a->data + 19 * 20 * a->elem_size, a->data + 3 * 20 * a->elem_size, 20 * a->elem_size);
+        KUNIT_EXPECT_EQ(test, MatrixRank(a), 19);
+        KUNIT_EXPECT_NULL(test, InverseMatrix(a));
+        KUNIT_EXPECT_EQ(test, RowReduce(a), 19);
+        expect_echelon(test, a, 19);
+        KUNIT_EXPECT_EQ(test, RowReduce(e), 20);
+        expect_echelon(test, e, 20);
+        FreeMatrix(a);
+        FreeMatrix(e);
+    }
+
+    // sizes and fields that do not match
+    a = CreateMatrix(fields[0], 4, 5);
+    b = CreateMatrix(fields[3], 5, 4);
+    c = CreateMatrix(fields[0], 4, 4);
+    KUNIT_ASSERT_NOT_NULL(test, a);
+    KUNIT_ASSERT_NOT_NULL(test, b);
+    KUNIT_ASSERT_NOT_NULL(test, c);
+    KUNIT_EXPECT_NULL(test, CreateMatrix(fields[0], 0, 5));
+    KUNIT_EXPECT_NULL(test, MultMatrix(a, b));
+    KUNIT_EXPECT_NULL(test, MultMatrix(a, c));
+    KUNIT_EXPECT_NULL(test, InverseMatrix(a));
+    KUNIT_EXPECT_NULL(test, PowMatrix(a, 2));
+    KUNIT_EXPECT_NULL(test, InverseMatrix(c)); // zero
+    KUNIT_EXPECT_EQ(test, MatrixRank(c), 0);
+    KUNIT_EXPECT_NULL(test, GetMatrixElement(a, 4, 0));
+    x = GetZero(fields[3]);
+    KUNIT_ASSERT_NOT_NULL(test, x);
+    KUNIT_EXPECT_EQ(test, SetMatrixElement(a, 0, 0, x), -1);
+    KUNIT_EXPECT_EQ(test, SetMatrixElement(b, 0, 5, x), -1);
+    FreeElement(x);
+    FreeMatrix(a);
+    FreeMatrix(b);
+    FreeMatrix(c);
+
+    for (int i = 0; i < 5; i++) FreeField(fields[i]);
+}
+
+static const int gf2_32[] = {1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0,
+                             0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1};
+
+/* binary as in FromUint32 for the polynomial basis */
+static uint32_t mult_binary(struct kunit *test, FiniteField f, uint32_t lhs, uint32_t rhs)
+{
+    FieldElement a = FromUint32(f, lhs), b = FromUint32(f, rhs), res;
+    uint32_t value;
+    KUNIT_ASSERT_NOT_NULL(test, a);
+    KUNIT_ASSERT_NOT_NULL(test, b);
+    res = Mult(a, b);
+    KUNIT_ASSERT_NOT_NULL(test, res);
+    value = ToUint32(res);
+    FreeElement(a);
+    FreeElement(b);
+    FreeElement(res);
+    return value;
+}
+
+static void tower_test(struct kunit *test)
+{
+    const int gf2_16[] = {1, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 1};
+    const int gf3_5[] = {1, 0, 0, 0, 2, 1};
+    FiniteField fields[] = {CreateF_q(2, 16, gf2_16), CreateF_q(2, 32, gf2_32)};
+    FiniteField other[] = {gf256(test), CreateF_q(3, 5, gf3_5), CreateF_p(251)};
+    const uint32_t masks[] = {0xffff, 0xffffffff};
+
+    for (int i = 0; i < 2; i++) {
+        struct TowerField *t;
+        uint32_t seed = 1;
+        KUNIT_ASSERT_NOT_NULL(test, fields[i]);
+        t = CreateTowerField(fields[i]);
+        KUNIT_ASSERT_NOT_NULL(test, t);
+        KUNIT_EXPECT_EQ(test, ToTower(t, 1), 1);
+        KUNIT_EXPECT_EQ(test, FromTower(t, 1), 1);
+        KUNIT_EXPECT_EQ(test, TowerInv(t, 0), 0);
+        for (int j = 0; j < 200; j++) {
+            uint32_t a, b, ta, tb;
+            seed = seed * 1103515245 + 12345;
+            a = (seed ^ seed << 13) & masks[i];
+            seed = seed * 1103515245 + 12345;
+            b = (seed ^ seed >> 7) & masks[i];
+            ta = ToTower(t, a);
+            tb = ToTower(t, b);
+            KUNIT_EXPECT_EQ(test, ta & ~masks[i], 0);
+            KUNIT_EXPECT_EQ(test, FromTower(t, ta), a);
+            KUNIT_EXPECT_EQ(test, ToTower(t, a ^ b), ta ^ tb);
+            KUNIT_EXPECT_EQ(test, FromTower(t, TowerMult(t, ta, tb)), mult_binary(test, fields[i], a, b));
+            if (a != 0) KUNIT_EXPECT_EQ(test, TowerMult(t, ta, TowerInv(t, ta)), 1);
+        }
+        FreeTowerField(t);
+        FreeField(fields[i]);
+    }
+
+    for (int i = 0; i < 3; i++) {
+        KUNIT_ASSERT_NOT_NULL(test, other[i]);
+        KUNIT_EXPECT_NULL(test, CreateTowerField(other[i]));
+        FreeField(other[i]);
+    }
+}
+
+/* seed layout as in write(): k, a_0..a_k-1, x_0..x_k-1, c */
+static const uint8_t seed_k2[] = {2, 1, 18, 125, 17, 8};
+static const uint8_t stream_k2[] = {
+    190, 162, 12, 114, 36, 121, 170, 91, 75, 99, 168, 101, 39, 88, 240, 129,
+    63, 245, 188, 98, 77, 54, 187, 223, 199, 234, 115, 208, 225, 194, 142, 227,
+};
+static const uint8_t seed_k3[] = {3, 1, 18, 19, 125, 17, 8, 48};
+static const uint8_t stream_k3[] = {
+    30, 138, 246, 4, 75, 245, 122, 58, 105, 90, 244, 207, 145, 230, 99, 77,
+    44, 176, 25, 25, 153, 101, 69, 167, 222, 45, 93, 183, 22, 247, 106, 138,
+};
+static const uint8_t seed_k16[] = {
+    16, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16,
+    100, 101, 102, 103, 104, 105, 106, 107, 108, 109, 110, 111, 112, 113, 114, 115, 7,
+};
+static const uint8_t stream_k16[] = {
+    83, 216, 128, 30, 162, 255, 226, 172, 211, 68, 167, 9, 178, 196, 56, 16,
+    136, 12, 73, 86, 66, 64, 107, 202, 132, 109, 36, 223, 26, 122, 13, 87,
+    31, 169, 201, 236, 46, 94, 104, 167, 187, 90, 244, 197, 26, 212, 179, 84,
+};
+
+static struct generator *seeded_generator(struct kunit *test, const uint8_t *seed, size_t len, bool block)
+{
+    struct generator *gen = kunit_kzalloc(test, sizeof(*gen), GFP_KERNEL);
+    KUNIT_ASSERT_NOT_NULL(test, gen);
+    KUNIT_ASSERT_EQ(test, setup_generator(gen), 0);
+    if (!block) { // без таблиц генератор работает пошагово
+        gen->tables = NULL;
+    }
+    KUNIT_ASSERT_EQ(test, seed_random(gen, seed, len), 0);
+    KUNIT_ASSERT_EQ(test, sync_generator(gen), 1);
+    KUNIT_EXPECT_EQ(test, gen->step != NULL, (bool) block);
+    return gen;
+}
+
+static void expect_stream(struct kunit *test, const uint8_t *seed, size_t seed_len,
+                          const uint8_t *expected, size_t len)
+{
+    uint8_t out[48];
+
+    for (int block = 0; block < 2; block++) {
+        struct generator *gen = seeded_generator(test, seed, seed_len, block);
+        /* неровные порции, чтобы пересечь границы блоков */
+        for (size_t n = 0, part = 1; n < len; n += part, part++) {
+            part = min(part, len - n);
+            KUNIT_ASSERT_EQ(test, fill_random(gen, out + n, part), 0);
+        }
+        KUNIT_EXPECT_MEMEQ(test, out, expected, len);
+        free_generator(gen);
+    }
+}
+
+static void generator_known_answer_test(struct kunit *test)
+{
+    expect_stream(test, seed_k2, sizeof(seed_k2), stream_k2, sizeof(stream_k2));
+    expect_stream(test, seed_k3, sizeof(seed_k3), stream_k3, sizeof(stream_k3));
+    expect_stream(test, seed_k16, sizeof(seed_k16), stream_k16, sizeof(stream_k16));
+}
+
+static void generator_reseed_test(struct kunit *test)
+{
+    struct generator *gen = seeded_generator(test, seed_k16, sizeof(seed_k16), true);
+    uint8_t out[sizeof(stream_k2)];
+
+    KUNIT_ASSERT_EQ(test, fill_random(gen, out, 5), 0);
+    KUNIT_ASSERT_EQ(test, seed_random(gen, seed_k2, sizeof(seed_k2)), 0);
+    KUNIT_ASSERT_EQ(test, sync_generator(gen), 1);
+    KUNIT_ASSERT_EQ(test, get_random(gen, out), 0);
+    KUNIT_ASSERT_EQ(test, fill_random(gen, out + 1, sizeof(out) - 1), 0);
+    KUNIT_EXPECT_MEMEQ(test, out, stream_k2, sizeof(stream_k2));
+    free_generator(gen);
+}
+
+/* seed_random only publishes, the running state switches at the next sync */
+static void generator_publish_test(struct kunit *test)
+{
+    struct generator *gen = seeded_generator(test, seed_k16, sizeof(seed_k16), true);
+    struct generator_config *old, *cfg;
+    uint8_t out[sizeof(stream_k2)];
+
+    KUNIT_ASSERT_EQ(test, fill_random(gen, out, 5), 0);
+    old = gen->cur;
+    KUNIT_ASSERT_EQ(test, seed_random(gen, seed_k3, sizeof(seed_k3)), 0);
+    KUNIT_EXPECT_PTR_EQ(test, gen->cur, old);
+    KUNIT_EXPECT_EQ(test, gen->k, 16);
+
+    /* only the last of several reseeds is picked up */
+    cfg = create_config(gen, seed_k2, sizeof(seed_k2));
+    KUNIT_ASSERT_NOT_NULL(test, cfg);
+    KUNIT_EXPECT_NOT_NULL(test, cfg->step);
+    publish_config(gen, cfg);
+    KUNIT_EXPECT_NULL(test, create_config(gen, seed_k3, sizeof(seed_k3) - 1));
+
+    /* fill alone keeps generating from the running state */
+    KUNIT_ASSERT_EQ(test, fill_random(gen, out, 5), 0);
+    KUNIT_EXPECT_PTR_EQ(test, gen->cur, old);
+
+    KUNIT_ASSERT_EQ(test, sync_generator(gen), 1);
+    KUNIT_EXPECT_PTR_EQ(test, gen->cur, cfg);
+    KUNIT_ASSERT_EQ(test, fill_random(gen, out, sizeof(out)), 0);
+    KUNIT_EXPECT_MEMEQ(test, out, stream_k2, sizeof(stream_k2));
+    KUNIT_EXPECT_EQ(test, sync_generator(gen), 0);
+    free_generator(gen);
+}
+
+/* pooled generators come back unseeded, whatever they were used for */
+static void generator_pool_test(struct kunit *test)
+{
+    struct generator *gens[3];
+    uint8_t out[sizeof(stream_k3)];
+
+    for (int i = 0; i < 3; i++) {
+        gens[i] = take_generator();
+        KUNIT_ASSERT_NOT_NULL(test, gens[i]);
+        KUNIT_ASSERT_EQ(test, seed_random(gens[i], seed_k16, sizeof(seed_k16)), 0);
+        KUNIT_ASSERT_EQ(test, sync_generator(gens[i]), 1);
+        KUNIT_ASSERT_EQ(test, fill_random(gens[i], out, 7 + i), 0);
+    }
+    gens[1]->tables = NULL; // reset restores block mode too
+    for (int i = 0; i < 3; i++) put_generator(gens[i]);
+
+    for (int i = 0; i < 3; i++) {
+        gens[i] = take_generator();
+        KUNIT_ASSERT_NOT_NULL(test, gens[i]);
+        KUNIT_EXPECT_EQ(test, gens[i]->k, 0);
+        KUNIT_EXPECT_LT(test, fill_random(gens[i], out, 1), 0);
+        KUNIT_ASSERT_EQ(test, seed_random(gens[i], seed_k3, sizeof(seed_k3)), 0);
+        KUNIT_ASSERT_EQ(test, sync_generator(gens[i]), 1);
+        KUNIT_ASSERT_EQ(test, fill_random(gens[i], out, sizeof(out)), 0);
+        KUNIT_EXPECT_MEMEQ(test, out, stream_k3, sizeof(out));
+        KUNIT_EXPECT_NOT_NULL(test, gens[i]->step);
+    }
+    for (int i = 0; i < 3; i++) put_generator(gens[i]);
+}
+
+static void generator_reserve_test(struct kunit *test)
+{
+    struct generator *gen = seeded_generator(test, seed_k3, sizeof(seed_k3), true);
+    uint8_t out[sizeof(stream_k3)];
+    uint8_t window[3], pos;
+
+    KUNIT_ASSERT_EQ(test, fill_random(gen, out, 2), 0);
+    /* x_0..x_2 = первый блок, из него отдан x_2, затем 5 блоков по 3 */
+    KUNIT_ASSERT_EQ(test, reserve_random(gen, 5, window, &pos), 16);
+    KUNIT_EXPECT_EQ(test, pos, 2);
+    KUNIT_EXPECT_MEMEQ(test, window, stream_k3, 3);
+
+    /* the generator continues right after the segment */
+    KUNIT_ASSERT_EQ(test, fill_random(gen, out, sizeof(out) - 18), 0);
+    KUNIT_EXPECT_MEMEQ(test, out, stream_k3 + 18, sizeof(out) - 18);
+    KUNIT_EXPECT_LT(test, reserve_random(gen, 0, window, &pos), 0);
+    free_generator(gen);
+
+    gen = seeded_generator(test, seed_k3, sizeof(seed_k3), false);
+    KUNIT_EXPECT_LT(test, reserve_random(gen, 1, window, &pos), 0); // block mode only
+    free_generator(gen);
+}
+
+static void generator_checkpoint_test(struct kunit *test)
+{
+    struct generator *gen = seeded_generator(test, seed_k16, sizeof(seed_k16), true);
+    struct generator *other;
+    struct generator_config *cur;
+    uint8_t seed[2 * 255 + 2], out[sizeof(stream_k16)], pos;
+    const size_t done = 21; // mid-window, block mode has pending outputs
+    int len;
+
+    KUNIT_ASSERT_EQ(test, fill_random(gen, out, done), 0);
+    len = save_random(gen, seed, &pos);
+    KUNIT_ASSERT_EQ(test, len, (int) sizeof(seed_k16));
+    KUNIT_EXPECT_EQ(test, pos, done % 16);
+    KUNIT_EXPECT_MEMEQ(test, seed + 1, seed_k16 + 1, 16); // a_i
+    KUNIT_EXPECT_EQ(test, seed[33], seed_k16[33]);       // c
+
+    /* another generator with another seed, block and scalar mode */
+    for (int block = 0; block < 2; block++) {
+        other = seeded_generator(test, seed_k3, sizeof(seed_k3), block);
+        KUNIT_ASSERT_EQ(test, restore_random(other, seed, len, pos), 0);
+        KUNIT_EXPECT_EQ(test, sync_generator(other), 0); // seed_k3 is not picked up again
+        KUNIT_ASSERT_EQ(test, fill_random(other, out, sizeof(out) - done), 0);
+        KUNIT_EXPECT_MEMEQ(test, out, stream_k16 + done, sizeof(out) - done);
+        free_generator(other);
+    }
+
+    /* same recurrence: the running seed is kept, only the window moves back */
+    cur = gen->cur;
+    KUNIT_ASSERT_EQ(test, fill_random(gen, out, 9), 0);
+    KUNIT_ASSERT_EQ(test, restore_random(gen, seed, len, pos), 0);
+    KUNIT_EXPECT_PTR_EQ(test, gen->cur, cur);
+    KUNIT_ASSERT_EQ(test, fill_random(gen, out, sizeof(out) - done), 0);
+    KUNIT_EXPECT_MEMEQ(test, out, stream_k16 + done, sizeof(out) - done);
+
+    KUNIT_EXPECT_LT(test, restore_random(gen, seed, len, 17), 0);
+    KUNIT_EXPECT_LT(test, restore_random(gen, seed, len - 1, pos), 0);
+    free_generator(gen);
+
+    other = take_generator();
+    KUNIT_ASSERT_NOT_NULL(test, other);
+    KUNIT_EXPECT_LT(test, save_random(other, seed, &pos), 0); // not seeded
+    put_generator(other);
+}
+
+static void generator_error_test(struct kunit *test)
+{
+    const uint8_t no_k[] = {0, 1, 2};
+    struct generator *gen = kunit_kzalloc(test, sizeof(*gen), GFP_KERNEL);
+    uint8_t out;
+
+    KUNIT_ASSERT_NOT_NULL(test, gen);
+    KUNIT_ASSERT_EQ(test, setup_generator(gen), 0);
+
+    KUNIT_EXPECT_LT(test, get_random(gen, &out), 0); // not seeded
+    KUNIT_EXPECT_LT(test, seed_random(gen, seed_k2, 0), 0);
+    KUNIT_EXPECT_LT(test, seed_random(gen, seed_k2, sizeof(seed_k2) - 1), 0);
+    KUNIT_EXPECT_LT(test, seed_random(gen, no_k, sizeof(no_k)), 0);
+    KUNIT_EXPECT_LT(test, fill_random(gen, &out, 1), 0);
+
+    /* неудачный reseed не портит текущее состояние */
+    KUNIT_ASSERT_EQ(test, seed_random(gen, seed_k2, sizeof(seed_k2)), 0);
+    KUNIT_EXPECT_LT(test, seed_random(gen, seed_k3, sizeof(seed_k3) - 1), 0);
+    KUNIT_ASSERT_EQ(test, sync_generator(gen), 1);
+    KUNIT_ASSERT_EQ(test, get_random(gen, &out), 0);
+    KUNIT_EXPECT_EQ(test, out, stream_k2[0]);
+
+    free_generator(gen);
+}
+
+static void api_test(struct kunit *test)
+{
+    struct chardriver_gen *gen = chardriver_gen_create();
+    uint8_t out[sizeof(stream_k16)];
+    uint8_t *expected = kunit_kzalloc(test, 1000, GFP_KERNEL);
+    uint8_t *long_out = kunit_kzalloc(test, 1000, GFP_KERNEL);
+    struct generator *ref;
+
+    KUNIT_ASSERT_NOT_NULL(test, gen);
+    KUNIT_ASSERT_NOT_NULL(test, expected);
+    KUNIT_ASSERT_NOT_NULL(test, long_out);
+    KUNIT_EXPECT_EQ(test, chardriver_gen_fill(gen, out, 1), -EINVAL); // not seeded
+    KUNIT_EXPECT_EQ(test, chardriver_gen_seed(gen, seed_k16, 3), -EINVAL);
+
+    KUNIT_ASSERT_EQ(test, chardriver_gen_seed(gen, seed_k16, sizeof(seed_k16)), 0);
+    KUNIT_ASSERT_EQ(test, chardriver_gen_fill(gen, out, 7), 0);
+    KUNIT_EXPECT_EQ(test, chardriver_gen_seed(gen, seed_k2, 1), -EINVAL); // keeps the stream
+    KUNIT_ASSERT_EQ(test, chardriver_gen_fill(gen, out + 7, sizeof(out) - 7), 0);
+    KUNIT_EXPECT_MEMEQ(test, out, stream_k16, sizeof(stream_k16));
+
+    KUNIT_ASSERT_EQ(test, chardriver_gen_seed(gen, seed_k2, sizeof(seed_k2)), 0);
+    KUNIT_ASSERT_EQ(test, chardriver_gen_fill(gen, out, sizeof(stream_k2)), 0);
+    KUNIT_EXPECT_MEMEQ(test, out, stream_k2, sizeof(stream_k2));
+
+    // several lock chunks in one call continue the stream seamlessly
+    ref = seeded_generator(test, seed_k3, sizeof(seed_k3), true);
+    KUNIT_ASSERT_EQ(test, fill_random(ref, expected, 1000), 0);
+    KUNIT_ASSERT_EQ(test, chardriver_gen_seed(gen, seed_k3, sizeof(seed_k3)), 0);
+    KUNIT_ASSERT_EQ(test, chardriver_gen_fill(gen, long_out, 1000), 0);
+    KUNIT_EXPECT_MEMEQ(test, long_out, expected, 1000);
+    free_generator(ref);
+
+    chardriver_gen_destroy(gen);
+}
+
+static void bench_field_mult(struct kunit *test)
+{
+    FiniteField f = gf256(test);
+    struct Uint8Tables *tables = CreateUint8Tables(f);
+    FieldElement a = byte(test, f, 0x53);
+    FieldElement b = byte(test, f, 0xca);
+    volatile uint8_t sink = 0;
+    u64 start, elapsed;
+
+    KUNIT_ASSERT_NOT_NULL(test, tables);
+
+    start = ktime_get_ns();
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        FieldElement res = Mult(a, b);
+        sink ^= ToUint8(res);
+        FreeElement(res);
+    }
+    elapsed = ktime_get_ns() - start;
+    kunit_info(test, "Mult: %llu ns/op\n", elapsed / BENCH_ITERATIONS);
+
+    start = ktime_get_ns();
+    for (int i = 0; i < BENCH_ITERATIONS / 16; i++) {
+        FieldElement lhs[16] = {a, a, a, a, a, a, a, a, a, a, a, a, a, a, a, a};
+        FieldElement rhs[16] = {b, b, b, b, b, b, b, b, b, b, b, b, b, b, b, b};
+        FieldElement res = DotProduct(lhs, rhs, 16);
+        sink ^= ToUint8(res);
+        FreeElement(res);
+    }
+    elapsed = ktime_get_ns() - start;
+    kunit_info(test, "DotProduct n=16: %llu ns/term\n", elapsed / (BENCH_ITERATIONS / 16 * 16));
+
+    start = ktime_get_ns();
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        sink ^= MultUint8(tables, i & 0xff, sink);
+    }
+    elapsed = ktime_get_ns() - start;
+    kunit_info(test, "MultUint8: %llu ns/op\n", elapsed / BENCH_ITERATIONS);
+
+    FreeElement(a);
+    FreeElement(b);
+    FreeUint8Tables(tables);
+    FreeField(f);
+}
+
+static void bench_pow(struct kunit *test)
+{
+    const int gf2_16[] = {1, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 1};
+    FiniteField f = CreateF_q(2, 16, gf2_16);
+    FieldElement a;
+    struct FixedBase *fb;
+    volatile bool sink = false;
+    u64 start, elapsed;
+
+    KUNIT_ASSERT_NOT_NULL(test, f);
+    a = FromUint16(f, 0xbeef);
+    fb = CreateFixedBase(a);
+    KUNIT_ASSERT_NOT_NULL(test, fb);
+
+    start = ktime_get_ns();
+    for (int i = 0; i < BENCH_ITERATIONS / 10; i++) {
+        FieldElement res = Pow(a, 0x7fff0000 + i);
+        sink ^= IsZero(res);
+        FreeElement(res);
+    }
+    elapsed = ktime_get_ns() - start;
+    kunit_info(test, "Pow GF(2^16): %llu ns/op\n", elapsed / (BENCH_ITERATIONS / 10));
+
+    start = ktime_get_ns();
+    for (int i = 0; i < BENCH_ITERATIONS / 10; i++) {
+        FieldElement res = FixedBasePow(fb, 0x7fff0000 + i);
+        sink ^= IsZero(res);
+        FreeElement(res);
+    }
+    elapsed = ktime_get_ns() - start;
+    kunit_info(test, "FixedBasePow GF(2^16): %llu ns/op\n", elapsed / (BENCH_ITERATIONS / 10));
+
+    FreeFixedBase(fb);
+    FreeElement(a);
+    FreeField(f);
+}
+
+static void bench_evaluation(struct kunit *test)
+{
+    const int gf2_16[] = {1, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 1};
+    FiniteField f = CreateF_q(2, 16, gf2_16);
+    int coeffs[33];
+    FieldElement *points, *res;
+    Polynom pol;
+    u64 start, elapsed;
+    size_t n = 1024;
+
+    KUNIT_ASSERT_NOT_NULL(test, f);
+    for (int i = 0; i < 33; i++) coeffs[i] = i % 3 != 1;
+    pol = PolynomFromArray(coeffs, 33, 2);
+    points = kcalloc(n, sizeof(FieldElement), GFP_KERNEL);
+    KUNIT_ASSERT_NOT_NULL(test, pol);
+    KUNIT_ASSERT_NOT_NULL(test, points);
+    for (size_t i = 0; i < n; i++) {
+        points[i] = FromUint16(f, i * 40503 + 1);
+        KUNIT_ASSERT_NOT_NULL(test, points[i]);
+    }
+
+    start = ktime_get_ns();
+    for (size_t i = 0; i < n; i++) FreeElement(naive_value(test, pol, points[i]));
+    elapsed = ktime_get_ns() - start;
+    kunit_info(test, "Mult/Add deg 32 GF(2^16): %llu ns/point\n", elapsed / n);
+
+    start = ktime_get_ns();
+    res = EvaluatePolynom(pol, points, n);
+    elapsed = ktime_get_ns() - start;
+    KUNIT_ASSERT_NOT_NULL(test, res);
+    kunit_info(test, "EvaluatePolynom deg 32 GF(2^16): %llu ns/point\n", elapsed / n);
+
+    FreeValues(res, n);
+    FreeValues(points, n);
+    FreePolynom(pol);
+    FreeField(f);
+}
+
+static void bench_matrix(struct kunit *test)
+{
+    const int gf2_16[] = {1, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 1};
+    FiniteField f = gf256(test);
+    Matrix small = CreateMatrix(f, 32, 32), a = CreateMatrix(f, 256, 256), res;
+    u64 start, elapsed;
+    int rank;
+
+    KUNIT_ASSERT_NOT_NULL(test, small);
+    KUNIT_ASSERT_NOT_NULL(test, a);
+    fill_matrix(small, 1);
+    fill_matrix(a, 2);
+
+    start = ktime_get_ns();
+    res = naive_product(test, small, small);
+    elapsed = ktime_get_ns() - start;
+    kunit_info(test, "Mult/Add product 32x32 GF(2^8): %llu us\n", elapsed / 1000);
+    FreeMatrix(res);
+
+    start = ktime_get_ns();
+    res = MultMatrix(small, small);
+    elapsed = ktime_get_ns() - start;
+    KUNIT_ASSERT_NOT_NULL(test, res);
+    kunit_info(test, "MultMatrix 32x32 GF(2^8): %llu us\n", elapsed / 1000);
+    FreeMatrix(res);
+
+    start = ktime_get_ns();
+    res = MultMatrix(a, a);
+    elapsed = ktime_get_ns() - start;
+    KUNIT_ASSERT_NOT_NULL(test, res);
+    kunit_info(test, "MultMatrix 256x256 GF(2^8): %llu us\n", elapsed / 1000);
+    FreeMatrix(res);
+
+    start = ktime_get_ns();
+    res = InverseMatrix(a);
+    elapsed = ktime_get_ns() - start;
+    kunit_info(test, "InverseMatrix 256x256 GF(2^8): %llu us\n", elapsed / 1000);
+    FreeMatrix(res);
+
+    start = ktime_get_ns();
+    rank = RowReduce(a);
+    elapsed = ktime_get_ns() - start;
+    KUNIT_EXPECT_GT(test, rank, 0);
+    kunit_info(test, "RowReduce 256x256 GF(2^8): %llu us, rank %d\n", elapsed / 1000, rank);
+
+    FreeMatrix(small);
+    FreeMatrix(a);
+    FreeField(f);
+
+    // no tables: coefficient vectors, XOR of bit masks for p = 2
+    f = CreateF_q(2, 16, gf2_16);
+    KUNIT_ASSERT_NOT_NULL(test, f);
+    a = CreateMatrix(f, 64, 64);
+    KUNIT_ASSERT_NOT_NULL(test, a);
+    fill_matrix(a, 3);
+
+    start = ktime_get_ns();
+    res = MultMatrix(a, a);
+    elapsed = ktime_get_ns() - start;
+    KUNIT_ASSERT_NOT_NULL(test, res);
+    kunit_info(test, "MultMatrix 64x64 GF(2^16): %llu us\n", elapsed / 1000);
+    FreeMatrix(res);
+
+    start = ktime_get_ns();
+    res = InverseMatrix(a);
+    elapsed = ktime_get_ns() - start;
+    kunit_info(test, "InverseMatrix 64x64 GF(2^16): %llu us\n", elapsed / 1000);
+    FreeMatrix(res);
+
+    FreeMatrix(a);
+    FreeField(f);
+}
+
+static void bench_tower(struct kunit *test)
+{
+    FiniteField f = CreateF_q(2, 32, gf2_32);
+    struct TowerField *t;
+    volatile uint32_t sink = 0;
+    u64 start, elapsed;
+
+    KUNIT_ASSERT_NOT_NULL(test, f);
+    start = ktime_get_ns();
+    t = CreateTowerField(f);
+    elapsed = ktime_get_ns() - start;
+    KUNIT_ASSERT_NOT_NULL(test, t);
+    kunit_info(test, "CreateTowerField GF(2^32): %llu us\n", elapsed / 1000);
+
+    start = ktime_get_ns();
+    for (int i = 0; i < BENCH_ITERATIONS / 10; i++) sink ^= mult_binary(test, f, i * 2654435761u, sink | 1);
+    elapsed = ktime_get_ns() - start;
+    kunit_info(test, "Mult GF(2^32): %llu ns/op\n", elapsed / (BENCH_ITERATIONS / 10));
+
+    start = ktime_get_ns();
+    for (int i = 0; i < BENCH_ITERATIONS; i++) sink ^= TowerMult(t, i * 2654435761u, sink | 1);
+    elapsed = ktime_get_ns() - start;
+    kunit_info(test, "TowerMult GF(2^32): %llu ns/op\n", elapsed / BENCH_ITERATIONS);
+
+    start = ktime_get_ns();
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        sink ^= FromTower(t, TowerMult(t, ToTower(t, i * 2654435761u), ToTower(t, sink | 1)));
+    }
+    elapsed = ktime_get_ns() - start;
+    kunit_info(test, "TowerMult GF(2^32) with basis change: %llu ns/op\n", elapsed / BENCH_ITERATIONS);
+
+    FreeTowerField(t);
+    FreeField(f);
+}
+
+static void bench_fill_random(struct kunit *test)
+{
+    const size_t len = 4096;
+    uint8_t *out = kunit_kmalloc(test, len, GFP_KERNEL);
+
+    KUNIT_ASSERT_NOT_NULL(test, out);
+    for (int block = 0; block < 2; block++) {
+        struct generator *gen = seeded_generator(test, seed_k16, sizeof(seed_k16), block);
+        u64 start = ktime_get_ns();
+        KUNIT_ASSERT_EQ(test, fill_random(gen, out, len), 0);
+        kunit_info(test, "fill_random k=16 %s: %llu ns/byte\n", block ? "block" : "scalar",
+                   (ktime_get_ns() - start) / len);
+        free_generator(gen);
+    }
+}
+
+static struct kunit_case chardriver_test_cases[] = {
+    KUNIT_CASE(polynom_arithmetic_test),
+    KUNIT_CASE(polynom_error_test),
+    KUNIT_CASE(finite_field_equality_test),
+    KUNIT_CASE(finite_field_lifetime_test),
+    KUNIT_CASE(field_element_axioms_test),
+    KUNIT_CASE(field_element_prime_field_test),
+    KUNIT_CASE(field_element_error_test),
+    KUNIT_CASE(field_element_dot_product_test),
+    KUNIT_CASE(field_element_pow_test),
+    KUNIT_CASE(binary_field_extension_test),
+    KUNIT_CASE(evaluation_test),
+    KUNIT_CASE(matrix_test),
+    KUNIT_CASE(tower_test),
+    KUNIT_CASE(generator_known_answer_test),
+    KUNIT_CASE(generator_reseed_test),
+    KUNIT_CASE(generator_publish_test),
+    KUNIT_CASE(generator_pool_test),
+    KUNIT_CASE(generator_reserve_test),
+    KUNIT_CASE(generator_checkpoint_test),
+    KUNIT_CASE(generator_error_test),
+    KUNIT_CASE(api_test),
+    KUNIT_CASE(bench_field_mult),
+    KUNIT_CASE(bench_pow),
+    KUNIT_CASE(bench_evaluation),
+    KUNIT_CASE(bench_matrix),
+    KUNIT_CASE(bench_tower),
+    KUNIT_CASE(bench_fill_random),
+    {}
+};
+
+static struct kunit_suite chardriver_test_suite = {
+    .name = "chardriver",
+    .test_cases = chardriver_test_cases,
+};
+
+kunit_test_suites(&chardriver_test_suite);